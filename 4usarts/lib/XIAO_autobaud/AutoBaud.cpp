@@ -0,0 +1,145 @@
+#include "AutoBaud.h"
+#include "wiring_private.h"     // for pinPeripheral() function
+
+// Event channels 0 to 2 are used for TC3 to TC5
+#define EVSYS_CHANNEL(tcIndex) (tcIndex)
+
+bool AutoBaud::startCapture() {
+    if (!extraSerialEnableTc(port, this))
+        return false;
+    uint8_t line = port->extintRX;
+    uint8_t channel = EVSYS_CHANNEL(port->tcIndex);
+
+    // EIC line of the RX pin generates events on the pin level
+    GCLK->CLKCTRL.reg = (uint16_t) (GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK0 | GCLK_CLKCTRL_ID_EIC);
+    while (GCLK->STATUS.bit.SYNCBUSY) ;
+    EIC->INTENCLR.reg = 1 << line;
+    uint8_t shift = 4 * (line % 8);
+    EIC->CONFIG[line / 8].reg = (EIC->CONFIG[line / 8].reg & ~(0xFul << shift)) | (EIC_CONFIG_SENSE0_HIGH_Val << shift);
+    EIC->EVCTRL.reg |= 1 << line;
+    EIC->CTRL.bit.ENABLE = 1;
+    while (EIC->STATUS.bit.SYNCBUSY) ;
+
+    // Route the EIC event to the TC
+    PM->APBCMASK.reg |= PM_APBCMASK_EVSYS;
+    EVSYS->USER.reg = (uint16_t) (EVSYS_USER_CHANNEL(channel + 1) | EVSYS_USER_USER(EVSYS_ID_USER_TC3_EVU + port->tcIndex));
+    EVSYS->CHANNEL.reg = EVSYS_CHANNEL_CHANNEL(channel) | EVSYS_CHANNEL_EDGSEL_NO_EVT_OUTPUT |
+        EVSYS_CHANNEL_PATH_ASYNCHRONOUS | EVSYS_CHANNEL_EVGEN(EVSYS_ID_GEN_EIC_EXTINT_0 + line);
+
+    // Period in CC0 (rising to rising edge), high pulse width in CC1
+    TcCount16 *tc = &port->tc->COUNT16;
+    tc->EVCTRL.reg = TC_EVCTRL_TCEI | TC_EVCTRL_EVACT_PPW;
+    tc->CTRLC.reg = TC_CTRLC_CPTEN0 | TC_CTRLC_CPTEN1;
+    while (tc->STATUS.bit.SYNCBUSY) ;
+    tc->CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_PRESCALER_DIV1 | TC_CTRLA_ENABLE;
+    while (tc->STATUS.bit.SYNCBUSY) ;
+
+    pinPeripheral(port->pinRX, PIO_EXTINT);
+    return true;
+}
+
+void AutoBaud::stopCapture() {
+    uint8_t line = port->extintRX;
+
+    pinPeripheral(port->pinRX, PIO_SERCOM_ALT);
+    extraSerialDisableTc(port, this);
+    EVSYS->CHANNEL.reg = EVSYS_CHANNEL_CHANNEL(EVSYS_CHANNEL(port->tcIndex));    // no generator
+    EVSYS->USER.reg = (uint16_t) EVSYS_USER_USER(EVSYS_ID_USER_TC3_EVU + port->tcIndex);
+    EIC->EVCTRL.reg &= ~(1ul << line);
+}
+
+unsigned long AutoBaud::detect(uint32_t timeout, bool snap, size_t samples) {
+    if (samples > AUTOBAUD_MAX_WIDTHS)
+        samples = AUTOBAUD_MAX_WIDTHS;
+    uint32_t startMicros = micros();
+    uint32_t start = millis();
+    TcCount16 *tc = &port->tc->COUNT16;
+
+    if (!startCapture())
+        return 0;
+    tc->INTFLAG.reg = TC_INTFLAG_MASK;
+    widthCount = 0;
+    bool valid = false;                    // no overflow since the last rising edge
+    bool haveHigh = false;
+    uint16_t high = 0;
+    while ((widthCount < samples) && (millis() - start < timeout)) {
+        uint8_t flags = tc->INTFLAG.reg;
+        if (flags & TC_INTFLAG_OVF) {      // long idle, the pending widths are meaningless
+            tc->INTFLAG.reg = TC_INTFLAG_OVF;
+            valid = false;
+            haveHigh = false;
+        }
+        if (flags & TC_INTFLAG_MC1) {      // falling edge: high pulse width
+            high = tc->CC[1].reg;
+            haveHigh = valid;
+            if (valid)
+                widths[widthCount++] = high;
+        }
+        if ((flags & TC_INTFLAG_MC0) && (widthCount < samples)) {   // rising edge: period
+            uint16_t period = tc->CC[0].reg;
+            if (valid && haveHigh && (period > high))
+                widths[widthCount++] = period - high;           // low pulse width
+            valid = true;
+            haveHigh = false;
+        }
+    }
+    stopCapture();
+
+    unsigned long baud = autoBaudEstimate(widths, widthCount, SystemCoreClock, snap);
+    if (baud)
+        extraSerialSetBaud(port, baud);
+    while (port->uart->available())        // bytes garbled while the rate was wrong
+        port->uart->read();
+    detectMicros = micros() - startMicros;
+    return baud;
+}
+
+bool AutoBaud::linHook(void *context) {
+    AutoBaud *ab = (AutoBaud *) context;
+    SercomUsart *usart = &ab->port->sercom->USART;
+
+    if (usart->INTFLAG.bit.RXBRK) {
+        usart->INTFLAG.reg = SERCOM_USART_INTFLAG_RXBRK;
+        ab->gotBreak = true;
+    }
+    if (ab->gotBreak) {
+        if (usart->STATUS.bit.ISF) {       // inconsistent sync field, wait for the next break
+            usart->STATUS.reg = SERCOM_USART_STATUS_ISF;
+            ab->gotBreak = false;
+        } else if (usart->INTFLAG.bit.RXC)
+            ab->syncDone = true;           // BAUD was updated by the sync field
+    }
+    return false;
+}
+
+unsigned long AutoBaud::detectLin(uint32_t timeout) {
+    SercomUsart *usart = &port->sercom->USART;
+    uint32_t startMicros = micros();
+    uint32_t start = millis();
+
+    gotBreak = false;
+    syncDone = false;
+    if (!extraSerialSetHook(port, linHook, this))
+        return 0;
+    extraSerialDisable(port);
+    uint8_t form = usart->CTRLA.bit.FORM;
+    usart->CTRLA.bit.FORM = (form == 1) ? 5 : 4;     // auto-baud, with or without parity
+    extraSerialEnable(port);
+    usart->INTFLAG.reg = SERCOM_USART_INTFLAG_RXBRK;
+    usart->INTENSET.reg = SERCOM_USART_INTENSET_RXBRK;
+
+    while (!syncDone && (millis() - start < timeout)) ;
+
+    usart->INTENCLR.reg = SERCOM_USART_INTENCLR_RXBRK;
+    extraSerialSetHook(port, NULL, NULL);
+    unsigned long baud = syncDone ? extraSerialGetBaud(port) : 0;
+
+    // Back to the normal frame format, BAUD is kept
+    extraSerialDisable(port);
+    usart->CTRLA.bit.FORM = form;
+    extraSerialEnable(port);
+    while (port->uart->available())        // the sync character may have been stored
+        port->uart->read();
+    detectMicros = micros() - startMicros;
+    return baud;
+}
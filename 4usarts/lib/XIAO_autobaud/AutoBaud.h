@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Arduino.h>
+#include "ExtraSerial.h"
+#include "AutoBaudEstimate.h"
+
+#define AUTOBAUD_MAX_WIDTHS (64)
+
+/*
+ * Auto-baud detection on the RX pin of an extra serial port.
+ *
+ * detect() temporarily gives the RX pin to the EIC, whose event drives the
+ * port's TC in pulse width and period capture mode (48 MHz ticks). The
+ * widths of the high and low pulses are collected for a few characters,
+ * autoBaudEstimate() turns them into a baud rate which is then written
+ * directly to the BAUD register. The characters used for the measurement
+ * are not received; detection needs traffic with isolated bits and works
+ * from about 750 baud (16 bit capture) to about 500 kbaud.
+ *
+ * detectLin() instead uses the SERCOM's own auto-baud frame format: a
+ * break character followed by the 0x55 sync character sets the BAUD
+ * register. The sender must produce the break, as in LIN.
+ */
+class AutoBaud {
+  public:
+    AutoBaud(ExtraSerialPort *port) : port(port) {}
+
+    // The port's Uart must have been started (at any rate). Returns the new
+    // baud rate or 0 if no rate was found before the timeout (ms). Both
+    // return 0 at once if the TC (detect) or the SERCOM interrupt
+    // (detectLin) of the port is used by another add-on library.
+    unsigned long detect(uint32_t timeout, bool snap = true, size_t samples = 32);
+    unsigned long detectLin(uint32_t timeout);
+
+    uint16_t widths[AUTOBAUD_MAX_WIDTHS];  // last measurement, for diagnostics
+    size_t widthCount = 0;
+    uint32_t detectMicros = 0;             // duration of the last detection
+
+  private:
+    static bool linHook(void *context);
+    bool startCapture();
+    void stopCapture();
+
+    ExtraSerialPort *port;
+    volatile bool gotBreak;
+    volatile bool syncDone;
+};
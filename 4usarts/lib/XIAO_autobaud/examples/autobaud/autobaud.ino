@@ -0,0 +1,98 @@
+/*
+ * autobaud
+ *
+ * Auto-baud detection on an extra hardware serial port of the Seeeduino
+ * XIAO board based on the Sam D21G microcontroller
+ *
+ */
+
+// Copyright 2022, Michel Deslierres, no rights reserved.
+// In those jurisdictions where releasing a work into the public domain may be a problem,
+// the BSD Zero Clause License <https://spdx.org/licenses/0BSD.html> applies.
+// SPDX-License-Identifier: 0BSD
+
+/*
+ * Serial1 transmits at each of the rates in the rates[] table, standard and
+ * non-standard ones. Serial2, which is started at a wrong rate, detects the
+ * rate from the pulse widths on its RX pin and is then expected to receive
+ * a test message correctly. The detected rate, the time taken and the
+ * result of the test are printed on Serial (= USBSerial).
+ *
+ * AutoBaud::detectLin() is not exercised here because the sender must
+ * produce a break followed by 0x55, as a LIN master does.
+ *
+ * Wiring
+ *
+ *   Serial1-TX --> Serial2-RX   A6 --> A9
+ *
+ * To build with PlatformIO, copy this file to ../src/ as autobaud.cpp
+ * in place of 4usarts.cpp.
+ */
+
+#include <Arduino.h>            // Needed for PlatformIO
+#include "wiring_private.h"     // for pinPeripheral() function
+#include "Serial2.h"
+#include "AutoBaud.h"
+
+const uint32_t rates[] = { 1200, 9600, 19200, 31250, 57600, 100000, 115200, 123456, 230400, 250000 };
+const char message[] = "The quick brown fox\n";
+
+AutoBaud autoBaud2(&Serial2Port);
+
+void setup() {
+  // Wait up to 10 seconds for Serial (= USBSerial) port to come up.
+  unsigned long startserial = millis();
+  while (!Serial && (millis() - startserial < 10000)) ;
+
+  Serial.println("\n\nautobaud");
+  Serial.println("--------");
+
+  Serial2.begin(9600);
+  pinPeripheral(PIN_SERIAL2_TX, PIO_SERCOM_ALT);
+  pinPeripheral(PIN_SERIAL2_RX, PIO_SERCOM_ALT);
+
+  Serial.println("Setup completed, starting loop");
+}
+
+// Waits for a line on Serial2 and compares it with the message
+bool receivedMessage(uint32_t timeout) {
+  char line[sizeof(message)];
+  size_t n = 0;
+  unsigned long start = millis();
+  while ((n < sizeof(message) - 1) && (millis() - start < timeout)) {
+    if (Serial2.available())
+      line[n++] = Serial2.read();
+  }
+  line[n] = 0;
+  return strcmp(line, message) == 0;
+}
+
+void loop() {
+  for (size_t i = 0; i < sizeof(rates)/sizeof(rates[0]); i++) {
+    uint32_t rate = rates[i];
+    // one character lasts 10 bit times, allow for 40 of them
+    uint32_t timeout = 400000UL / rate + 100;
+
+    Serial1.begin(rate);
+    Serial2.begin((rate == 9600) ? 19200 : 9600);       // start at a wrong rate
+    pinPeripheral(PIN_SERIAL2_TX, PIO_SERCOM_ALT);
+    pinPeripheral(PIN_SERIAL2_RX, PIO_SERCOM_ALT);
+
+    Serial1.print("UUUU ");                             // isolated bits help
+    Serial1.print(message);
+    unsigned long detected = autoBaud2.detect(timeout, rate != 123456);   // keep 123456 as measured
+    Serial1.flush();
+    delay(2);
+    while (Serial2.available())
+      Serial2.read();
+
+    Serial1.print(message);
+    bool ok = receivedMessage(timeout);
+
+    Serial.printf("%6lu baud: detected %6lu (%u widths, %lu us), message %s\n", rate, detected,
+      autoBaud2.widthCount, autoBaud2.detectMicros, ok ? "received" : "NOT received");
+    Serial1.end();
+  }
+  Serial.println();
+  delay(5000);
+}
@@ -0,0 +1,60 @@
+#include "AutoBaudEstimate.h"
+
+#define MIN_WIDTHS     (4)                 // usable widths needed for an estimate
+#define MAX_BITS       (10)                // longest pulse: start bit + 8 zeros + parity
+
+static const uint32_t standardRates[] = {
+    1200, 2400, 4800, 9600, 14400, 19200, 28800, 31250, 38400, 57600, 76800,
+    115200, 230400, 250000, 460800, 500000, 921600, 1000000
+};
+
+uint32_t autoBaudEstimate(const uint16_t *widths, size_t count, uint32_t tickHz, bool snap) {
+    // Shortest width confirmed by another one within 25%, which skips glitches
+    uint32_t shortest = UINT32_MAX;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t w = widths[i];
+        if (!w || (w >= shortest))
+            continue;
+        for (size_t j = 0; j < count; j++) {
+            if ((j != i) && (4*widths[j] >= 3*w) && (4*widths[j] <= 5*w)) {
+                shortest = w;
+                break;
+            }
+        }
+    }
+    if (shortest == UINT32_MAX)
+        return 0;
+
+    // The first pass averages the single bit pulses, the next ones round every
+    // width with the refined bit time (kept in 1/256 tick)
+    uint32_t bit256 = shortest << 8;
+    for (int pass = 0; pass < 3; pass++) {
+        uint64_t totalWidth = 0;
+        uint32_t totalBits = 0;
+        size_t used = 0;
+        for (size_t i = 0; i < count; i++) {
+            uint32_t bits = (((uint32_t) widths[i] << 8) + bit256/2) / bit256;
+            if ((bits == 0) || (bits > ((pass == 0) ? 1 : MAX_BITS)))
+                continue;
+            totalWidth += widths[i];
+            totalBits += bits;
+            used++;
+        }
+        if ((used < MIN_WIDTHS) && (pass > 0))
+            return 0;
+        if (used == 0)
+            return 0;
+        bit256 = (uint32_t) ((totalWidth << 8) / totalBits);
+    }
+    uint32_t baud = (uint32_t) (((uint64_t) tickHz << 8) / bit256);
+
+    if (snap) {
+        for (size_t i = 0; i < sizeof(standardRates)/sizeof(standardRates[0]); i++) {
+            uint32_t rate = standardRates[i];
+            uint32_t diff = (baud > rate) ? baud - rate : rate - baud;
+            if ((uint64_t) diff * 1000 < (uint64_t) rate * AUTOBAUD_SNAP_TOLERANCE)
+                return rate;
+        }
+    }
+    return baud;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Relative tolerance, in per mille, within which a measured rate is
+// replaced by the nearest standard rate (strictly less than). 2% keeps
+// common non-standard rates such as 74880 (2.5% below 76800) as measured.
+#define AUTOBAUD_SNAP_TOLERANCE (20)
+
+/*
+ * Estimates the baud rate from the widths, in ticks of a tickHz clock, of
+ * the high and low pulses seen on an RX line.
+ *
+ * The shortest pulse is taken as a first estimate of the bit time, each
+ * width is then rounded to a whole number of bits and the bit time refined
+ * as total width / total bits. The traffic must contain isolated bits
+ * (most text does, 'U' = 0x55 is ideal). With snap, a result within
+ * AUTOBAUD_SNAP_TOLERANCE of a standard rate is replaced by that rate.
+ *
+ * Returns 0 if there are too few usable widths. Does not depend on the
+ * hardware, it is checked on the host against simulated 8N1 traffic by the
+ * native unit tests in 4usarts/test/.
+ */
+uint32_t autoBaudEstimate(const uint16_t *widths, size_t count, uint32_t tickHz, bool snap);
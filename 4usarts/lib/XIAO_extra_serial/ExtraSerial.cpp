@@ -0,0 +1,87 @@
+#include "ExtraSerial.h"
+
+bool extraSerialSetHook(ExtraSerialPort *port, ExtraSerialHook hook, void *context) {
+    bool ok = true;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (hook && port->hook && ((port->hook != hook) || (port->hookContext != context)))
+        ok = false;
+    else {
+        port->hook = hook;
+        port->hookContext = context;
+    }
+    __set_PRIMASK(primask);
+    return ok;
+}
+
+void extraSerialDisable(ExtraSerialPort *port) {
+    SercomUsart *usart = &port->sercom->USART;
+    usart->CTRLA.bit.ENABLE = 0;
+    while (usart->SYNCBUSY.bit.ENABLE) ;
+}
+
+void extraSerialEnable(ExtraSerialPort *port) {
+    SercomUsart *usart = &port->sercom->USART;
+    while (usart->SYNCBUSY.bit.CTRLB) ;
+    usart->CTRLA.bit.ENABLE = 1;
+    while (usart->SYNCBUSY.bit.ENABLE) ;
+}
+
+// Samples per bit for CTRLA.SAMPR 0 to 4, odd values are the fractional modes
+static const uint8_t sampleRates[5] = { 16, 16, 8, 8, 3 };
+
+void extraSerialSetBaud(ExtraSerialPort *port, unsigned long baud) {
+    SercomUsart *usart = &port->sercom->USART;
+    uint8_t sampr = usart->CTRLA.bit.SAMPR;
+    uint32_t samples = sampleRates[(sampr < 5) ? sampr : 0];
+
+    extraSerialDisable(port);
+    if (sampr & 1) {
+        uint32_t baudTimes8 = (SystemCoreClock * 8) / (samples * baud);
+        usart->BAUD.FRAC.FP = baudTimes8 % 8;
+        usart->BAUD.FRAC.BAUD = baudTimes8 / 8;
+    } else
+        usart->BAUD.reg = (uint16_t) (65536 - ((uint64_t) 65536 * samples * baud + SystemCoreClock/2) / SystemCoreClock);
+    extraSerialEnable(port);
+}
+
+unsigned long extraSerialGetBaud(ExtraSerialPort *port) {
+    SercomUsart *usart = &port->sercom->USART;
+    uint8_t sampr = usart->CTRLA.bit.SAMPR;
+    uint32_t samples = sampleRates[(sampr < 5) ? sampr : 0];
+
+    if (sampr & 1) {
+        uint32_t baudTimes8 = usart->BAUD.FRAC.BAUD * 8 + usart->BAUD.FRAC.FP;
+        return baudTimes8 ? (SystemCoreClock * 8) / (samples * baudTimes8) : 0;
+    }
+    return (unsigned long) (((uint64_t) SystemCoreClock * (65536 - usart->BAUD.reg)) / ((uint64_t) samples * 65536));
+}
+
+bool extraSerialEnableTc(ExtraSerialPort *port, void *owner) {
+    Tc *tc = port->tc;
+
+    if (port->tcOwner && (port->tcOwner != owner))
+        return false;
+    port->tcOwner = owner;
+
+    PM->APBCMASK.reg |= PM_APBCMASK_TC3 << port->tcIndex;
+    GCLK->CLKCTRL.reg = (uint16_t) (GCLK_CLKCTRL_CLKEN | GCLK_CLKCTRL_GEN_GCLK0 |
+        ((port->tcIndex == 0) ? GCLK_CLKCTRL_ID_TCC2_TC3 : GCLK_CLKCTRL_ID_TC4_TC5));
+    while (GCLK->STATUS.bit.SYNCBUSY) ;
+
+    NVIC_DisableIRQ(port->tcIrqn);
+    tc->COUNT16.CTRLA.reg = TC_CTRLA_SWRST;
+    while (tc->COUNT16.CTRLA.bit.SWRST) ;
+    NVIC_ClearPendingIRQ(port->tcIrqn);
+    return true;
+}
+
+void extraSerialDisableTc(ExtraSerialPort *port, void *owner) {
+    if (port->tcOwner != owner)
+        return;
+    TcCount16 *tc = &port->tc->COUNT16;
+    NVIC_DisableIRQ(port->tcIrqn);
+    tc->CTRLA.bit.ENABLE = 0;
+    while (tc->STATUS.bit.SYNCBUSY) ;
+    port->tcOwner = NULL;
+}
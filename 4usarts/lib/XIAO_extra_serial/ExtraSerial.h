@@ -0,0 +1,50 @@
+#pragma once
+
+#include "variant.h"
+
+// Optional hook called first thing in the SERCOMx_Handler of an extra serial
+// port, or in the handler of the TC paired with the port. A SERCOM hook returns
+// true if it fully serviced the interrupt, in which case Uart::IrqHandler() is
+// not called. The value returned by a TC hook is ignored.
+typedef bool (*ExtraSerialHook)(void *context);
+
+// Hardware resources of an extra serial port used by the add-on libraries
+typedef struct {
+  Uart *uart;
+  Sercom *sercom;               // SERCOM registers
+  IRQn_Type irqn;               // SERCOM interrupt
+  uint8_t pinRX;
+  uint8_t pinTX;
+  uint8_t extintRX;             // EIC line of the RX pin
+  Tc *tc;                       // TC paired with the port
+  IRQn_Type tcIrqn;
+  uint8_t tcIndex;              // 0 = TC3, 1 = TC4, 2 = TC5
+  volatile ExtraSerialHook hook;
+  void * volatile hookContext;
+  void * volatile tcOwner;      // instance using the TC, NULL if it is free
+} ExtraSerialPort;
+
+// Installs (or removes with NULL) the SERCOM interrupt hook of a port. There
+// is a single hook per port so the add-on libraries exclude each other on a
+// port: returns false, leaving the installed hook in place, if the port is
+// already hooked by someone else.
+bool extraSerialSetHook(ExtraSerialPort *port, ExtraSerialHook hook, void *context);
+
+// Disables and re-enables the SERCOM of a port, to change its enable-protected
+// registers (CTRLA, CTRLB, BAUD) without going through Uart::begin()
+void extraSerialDisable(ExtraSerialPort *port);
+void extraSerialEnable(ExtraSerialPort *port);
+
+// Programs the BAUD register of a running port directly, honouring the sample
+// rate and arithmetic/fractional mode already set by Uart::begin(), and
+// returns the baud rate currently programmed
+void extraSerialSetBaud(ExtraSerialPort *port, unsigned long baud);
+unsigned long extraSerialGetBaud(ExtraSerialPort *port);
+
+// Reserves the TC of the port for owner, clocks it from GCLK0 (48 MHz) and
+// resets it. Returns false if the TC is reserved by another owner. The TC
+// interrupt handlers are in the separate XIAO_extra_tc library (ExtraSerialTc.h).
+bool extraSerialEnableTc(ExtraSerialPort *port, void *owner);
+
+// Stops the TC of the port and releases it if it is reserved by owner
+void extraSerialDisableTc(ExtraSerialPort *port, void *owner);
@@ -2,6 +2,11 @@
 
 Uart Serial2(&sercom0, PIN_SERIAL2_RX, PIN_SERIAL2_TX, PAD_SERIAL2_RX, PAD_SERIAL2_TX);
 
+ExtraSerialPort Serial2Port = { &Serial2, SERCOM0, SERCOM0_IRQn, PIN_SERIAL2_RX, PIN_SERIAL2_TX,
+    EXTINT_SERIAL2_RX, TC3, TC3_IRQn, 0, NULL, NULL, NULL };
+
 void SERCOM0_Handler(void) {
+    if (Serial2Port.hook && Serial2Port.hook(Serial2Port.hookContext))
+        return;
     Serial2.IrqHandler();
 }
@@ -1,12 +1,15 @@
 #pragma once
 
 #include "variant.h"
+#include "ExtraSerial.h"
 
 #define PIN_SERIAL2_TX (10ul)              // TX on A10
 #define PIN_SERIAL2_RX (9ul)               // RX on A9
 #define PAD_SERIAL2_TX (UART_TX_PAD_2)
 #define PAD_SERIAL2_RX (SERCOM_RX_PAD_1)
+#define EXTINT_SERIAL2_RX (EXTERNAL_INT_5)    // PA05 is on EXTINT[5]
 
 extern Uart Serial2;
+extern ExtraSerialPort Serial2Port;      // SERCOM0 + TC3
 
 void SERCOM0_Handler(void);
@@ -2,6 +2,11 @@
 
 Uart Serial3(&sercom2, PIN_SERIAL3_RX, PIN_SERIAL3_TX, PAD_SERIAL3_RX, PAD_SERIAL3_TX);
 
+ExtraSerialPort Serial3Port = { &Serial3, SERCOM2, SERCOM2_IRQn, PIN_SERIAL3_RX, PIN_SERIAL3_TX,
+    EXTINT_SERIAL3_RX, TC4, TC4_IRQn, 1, NULL, NULL, NULL };
+
 void SERCOM2_Handler(void) {
+    if (Serial3Port.hook && Serial3Port.hook(Serial3Port.hookContext))
+        return;
     Serial3.IrqHandler();
 }
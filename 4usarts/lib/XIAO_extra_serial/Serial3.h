@@ -1,12 +1,15 @@
 #pragma once
 
 #include "variant.h"
+#include "ExtraSerial.h"
 
 #define PIN_SERIAL3_TX (4ul)              // TX on A4
 #define PIN_SERIAL3_RX (5ul)              // RX on A5
 #define PAD_SERIAL3_TX (UART_TX_PAD_0)
 #define PAD_SERIAL3_RX (SERCOM_RX_PAD_1)
+#define EXTINT_SERIAL3_RX (EXTERNAL_INT_9)    // PA09 is on EXTINT[9]
 
 extern Uart Serial3;
+extern ExtraSerialPort Serial3Port;      // SERCOM2 + TC4
 
 void SERCOM2_Handler(void);
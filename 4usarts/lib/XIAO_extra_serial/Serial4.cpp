@@ -2,6 +2,11 @@
 
 Uart Serial4(&sercom1, PIN_SERIAL4_RX, PIN_SERIAL4_TX, PAD_SERIAL4_RX, PAD_SERIAL4_TX);
 
+ExtraSerialPort Serial4Port = { &Serial4, SERCOM1, SERCOM1_IRQn, PIN_SERIAL4_RX, PIN_SERIAL4_TX,
+    EXTINT_SERIAL4_RX, TC5, TC5_IRQn, 2, NULL, NULL, NULL };
+
 void SERCOM1_Handler(void) {
+    if (Serial4Port.hook && Serial4Port.hook(Serial4Port.hookContext))
+        return;
     Serial4.IrqHandler();
 }
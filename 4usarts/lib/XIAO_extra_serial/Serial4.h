@@ -1,12 +1,15 @@
 #pragma once
 
 #include "variant.h"
+#include "ExtraSerial.h"
 
 #define PIN_SERIAL4_TX (17ul)              // TX on SWCLK
 #define PIN_SERIAL4_RX (18ul)              // RX on SWDIO
 #define PAD_SERIAL4_TX (UART_TX_PAD_2)
 #define PAD_SERIAL4_RX (SERCOM_RX_PAD_3)
+#define EXTINT_SERIAL4_RX (EXTERNAL_INT_11)    // PA31 is on EXTINT[11]
 
 extern Uart Serial4;
+extern ExtraSerialPort Serial4Port;      // SERCOM1 + TC5
 
 void SERCOM1_Handler(void);
@@ -0,0 +1,41 @@
+#include "ExtraSerialTc.h"
+
+static volatile ExtraSerialHook tcHooks[3];
+static void * volatile tcContexts[3];
+
+bool extraSerialSetTcHook(ExtraSerialPort *port, ExtraSerialHook hook, void *context) {
+    uint8_t index = port->tcIndex;
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (hook && tcHooks[index] && ((tcHooks[index] != hook) || (tcContexts[index] != context))) {
+        __set_PRIMASK(primask);
+        return false;
+    }
+    tcHooks[index] = hook;
+    tcContexts[index] = context;
+    __set_PRIMASK(primask);
+    if (hook)
+        NVIC_EnableIRQ(port->tcIrqn);
+    else
+        NVIC_DisableIRQ(port->tcIrqn);
+    return true;
+}
+
+static void tcDispatch(uint8_t index, Tc *tc) {
+    if (tcHooks[index])
+        tcHooks[index](tcContexts[index]);
+    else
+        tc->COUNT16.INTFLAG.reg = TC_INTFLAG_MASK;   // no hook, just acknowledge
+}
+
+void TC3_Handler(void) {
+    tcDispatch(0, TC3);
+}
+
+void TC4_Handler(void) {
+    tcDispatch(1, TC4);
+}
+
+void TC5_Handler(void) {
+    tcDispatch(2, TC5);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "ExtraSerial.h"
+
+// TC3_Handler, TC4_Handler and TC5_Handler dispatching to the TC hooks of the
+// extra serial ports. They override the core's tone() (TC5) handler and
+// conflict with the Servo library (TC4), which is why they are kept out of
+// XIAO_extra_serial: only add this library to projects that need TC interrupts.
+
+// Installs (or removes with NULL) the TC interrupt hook of a port. Returns
+// false, leaving the installed hook in place, if the TC is already hooked by
+// someone else.
+bool extraSerialSetTcHook(ExtraSerialPort *port, ExtraSerialHook hook, void *context);
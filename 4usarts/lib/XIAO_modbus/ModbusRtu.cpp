@@ -0,0 +1,218 @@
+#include "ModbusRtu.h"
+#include "wiring_private.h"     // for pinPeripheral() function
+
+// TC ticks at 48 MHz / 64 = 750 kHz so that t3.5 at 1200 baud (32 ms) fits in 16 bits
+#define TICKS_PER_MS (750u)
+
+bool ModbusRtuMaster::begin(ExtraSerialPort *port, unsigned long baud, uint16_t config, int dePin) {
+    if (this->port || port->hook || !extraSerialEnableTc(port, this))
+        return false;
+    this->port = port;
+    this->dePin = dePin;
+    if (dePin >= 0) {
+        pinMode(dePin, OUTPUT);
+        digitalWrite(dePin, LOW);
+    }
+    port->uart->begin(baud, config);
+    pinPeripheral(port->pinTX, PIO_SERCOM_ALT);
+    pinPeripheral(port->pinRX, PIO_SERCOM_ALT);
+
+    // Above 19200 baud the specification fixes t1.5 = 750 µs and t3.5 = 1750 µs,
+    // otherwise they are 1.5 and 3.5 times the 11 bit character time.
+    uint32_t t15 = (baud > 19200) ? 750 : 16500000UL / baud;
+    uint32_t t35 = (baud > 19200) ? 1750 : 38500000UL / baud;
+
+    TcCount16 *tc = &port->tc->COUNT16;
+    tc->CTRLA.reg = TC_CTRLA_MODE_COUNT16 | TC_CTRLA_WAVEGEN_NFRQ | TC_CTRLA_PRESCALER_DIV64;
+    tc->CC[0].reg = (uint16_t) (t15 * TICKS_PER_MS / 1000);
+    while (tc->STATUS.bit.SYNCBUSY) ;
+    tc->CC[1].reg = (uint16_t) (t35 * TICKS_PER_MS / 1000);
+    while (tc->STATUS.bit.SYNCBUSY) ;
+    tc->CTRLBSET.reg = TC_CTRLBSET_ONESHOT;
+    while (tc->STATUS.bit.SYNCBUSY) ;
+    tc->INTENSET.reg = TC_INTENSET_MC0 | TC_INTENSET_MC1;
+    tc->CTRLA.bit.ENABLE = 1;
+    while (tc->STATUS.bit.SYNCBUSY) ;
+    tc->CTRLBSET.reg = TC_CTRLBSET_CMD_STOP;   // a one-shot TC starts counting when enabled
+    while (tc->STATUS.bit.SYNCBUSY) ;
+    tc->INTFLAG.reg = TC_INTFLAG_MASK;
+
+    memset(&stats, 0, sizeof(stats));
+    state = MODBUS_IDLE;
+    lineIdle = true;
+    extraSerialSetTcHook(port, tcHook, this);
+    extraSerialSetHook(port, sercomHook, this);
+    return true;
+}
+
+void ModbusRtuMaster::end() {
+    if (!port)
+        return;
+    extraSerialSetHook(port, NULL, NULL);
+    extraSerialSetTcHook(port, NULL, NULL);
+    extraSerialDisableTc(port, this);
+    port->sercom->USART.INTENCLR.reg = SERCOM_USART_INTENCLR_TXC;
+    port->uart->end();
+    port = NULL;
+}
+
+// Called from the SERCOM and TC interrupts only
+void ModbusRtuMaster::retrigger() {
+    TcCount16 *tc = &port->tc->COUNT16;
+    tc->CTRLBSET.reg = TC_CTRLBSET_CMD_RETRIGGER;
+    tc->INTFLAG.reg = TC_INTFLAG_MC0 | TC_INTFLAG_MC1;
+    pastT15 = false;
+    lineIdle = false;
+}
+
+bool ModbusRtuMaster::sercomHook(void *context) {
+    ModbusRtuMaster *master = (ModbusRtuMaster *) context;
+    SercomUsart *usart = &master->port->sercom->USART;
+    uint8_t flags = usart->INTFLAG.reg & usart->INTENSET.reg;
+
+    if (flags & SERCOM_USART_INTFLAG_RXC) {
+        if (master->inFrame && master->pastT15)
+            master->gapError = true;
+        master->retrigger();
+        master->inFrame = true;
+    }
+    if (flags & SERCOM_USART_INTFLAG_TXC) {
+        usart->INTFLAG.reg = SERCOM_USART_INTFLAG_TXC;
+        // The DRE interrupt stays enabled while the Uart TX ring holds data
+        if (!(usart->INTENSET.reg & SERCOM_USART_INTENSET_DRE)) {
+            usart->INTENCLR.reg = SERCOM_USART_INTENCLR_TXC;
+            if (master->dePin >= 0)
+                digitalWrite(master->dePin, LOW);
+            master->txDoneMillis = millis();
+            master->txDone = true;
+            master->retrigger();
+            master->inFrame = false;
+        }
+    }
+    return false;   // let Uart::IrqHandler() store the received byte
+}
+
+bool ModbusRtuMaster::tcHook(void *context) {
+    ModbusRtuMaster *master = (ModbusRtuMaster *) context;
+    TcCount16 *tc = &master->port->tc->COUNT16;
+    uint8_t flags = tc->INTFLAG.reg;
+
+    tc->INTFLAG.reg = flags;
+    if (flags & TC_INTFLAG_MC0)
+        master->pastT15 = true;
+    if (flags & TC_INTFLAG_MC1) {
+        tc->CTRLBSET.reg = TC_CTRLBSET_CMD_STOP;
+        master->pastT15 = false;
+        master->inFrame = false;
+        master->lineIdle = true;
+    }
+    return true;
+}
+
+bool ModbusRtuMaster::request(uint8_t slave, uint8_t function, const uint8_t *data, uint8_t length) {
+    if (!port || !ready() || length > MODBUS_MAX_ADU - 4)
+        return false;
+
+    uint16_t n = 0;
+    txFrame[n++] = slave;
+    txFrame[n++] = function;
+    memcpy(txFrame + n, data, length);
+    n += length;
+    uint16_t crc = modbusCrc16(txFrame, n);
+    txFrame[n++] = crc & 0xFF;
+    txFrame[n++] = crc >> 8;
+
+    while (port->uart->available())     // discard anything left over on the line
+        port->uart->read();
+    this->slave = slave;
+    this->function = function;
+    rxLength = 0;
+    inFrame = false;
+    gapError = false;
+    txDone = false;
+    lineIdle = false;
+    state = MODBUS_BUSY;
+    stats.requests++;
+    startMicros = micros();
+
+    SercomUsart *usart = &port->sercom->USART;
+    if (dePin >= 0)
+        digitalWrite(dePin, HIGH);
+    usart->INTFLAG.reg = SERCOM_USART_INTFLAG_TXC;
+    port->uart->write(txFrame, n);
+    usart->INTENSET.reg = SERCOM_USART_INTENSET_TXC;
+    return true;
+}
+
+bool ModbusRtuMaster::readHoldingRegisters(uint8_t slave, uint16_t address, uint16_t count) {
+    uint8_t data[4] = { (uint8_t) (address >> 8), (uint8_t) address, (uint8_t) (count >> 8), (uint8_t) count };
+    return request(slave, 0x03, data, sizeof(data));
+}
+
+bool ModbusRtuMaster::writeSingleRegister(uint8_t slave, uint16_t address, uint16_t value) {
+    uint8_t data[4] = { (uint8_t) (address >> 8), (uint8_t) address, (uint8_t) (value >> 8), (uint8_t) value };
+    return request(slave, 0x06, data, sizeof(data));
+}
+
+uint16_t ModbusRtuMaster::getRegister(uint8_t index) {
+    uint16_t offset = 3 + 2*index;
+    if (state != MODBUS_OK || offset + 1 >= rxLength - 2)
+        return 0;
+    return (rxFrame[offset] << 8) | rxFrame[offset + 1];
+}
+
+ModbusStatus ModbusRtuMaster::complete(ModbusStatus result) {
+    uint32_t roundTrip = micros() - startMicros;
+    stats.lastRoundTrip = roundTrip;
+    if (roundTrip > stats.maxRoundTrip)
+        stats.maxRoundTrip = roundTrip;
+    switch (result) {
+        case MODBUS_OK:          stats.replies++; break;
+        case MODBUS_EXCEPTION:   stats.replies++; stats.exceptions++; break;
+        case MODBUS_TIMEOUT:     stats.timeouts++; break;
+        case MODBUS_CRC_ERROR:   stats.crcErrors++; break;
+        default:                 stats.frameErrors++; break;
+    }
+    state = result;
+    return state;
+}
+
+ModbusStatus ModbusRtuMaster::poll() {
+    if (state != MODBUS_BUSY)
+        return state;
+
+    // Move received bytes out of the Uart ring as they arrive so that replies
+    // longer than the ring are not lost
+    while (port->uart->available()) {
+        int c = port->uart->read();
+        if (rxLength < MODBUS_MAX_ADU)
+            rxFrame[rxLength++] = c;
+        else
+            gapError = true;
+    }
+
+    // The response timeout runs from the end of the request to the first
+    // byte of the reply, a reply in progress is only ended by t3.5
+    if (!txDone)
+        return state;
+    if (rxLength == 0) {
+        if ((slave == 0) && lineIdle)     // broadcast, no reply expected
+            return complete(MODBUS_OK);
+        if ((millis() - txDoneMillis > timeout) && !port->uart->available())
+            return complete(MODBUS_TIMEOUT);
+        return state;
+    }
+    if (!lineIdle)
+        return state;
+
+    if (gapError || rxLength < 5 || rxFrame[0] != slave)
+        return complete(MODBUS_FRAME_ERROR);
+    uint16_t crc = modbusCrc16(rxFrame, rxLength - 2);
+    if ((rxFrame[rxLength - 2] != (crc & 0xFF)) || (rxFrame[rxLength - 1] != (crc >> 8)))
+        return complete(MODBUS_CRC_ERROR);
+    if (rxFrame[1] == (function | 0x80))
+        return complete(MODBUS_EXCEPTION);
+    if (rxFrame[1] != function)
+        return complete(MODBUS_FRAME_ERROR);
+    return complete(MODBUS_OK);
+}
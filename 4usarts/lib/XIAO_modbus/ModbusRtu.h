@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Arduino.h>
+#include "ExtraSerialTc.h"
+#include "ModbusCrc.h"
+
+#define MODBUS_MAX_ADU (256)               // address + PDU (253 bytes) + CRC
+
+enum ModbusStatus : uint8_t {
+  MODBUS_IDLE,                             // no request issued yet
+  MODBUS_BUSY,                             // request sent, waiting for the reply
+  MODBUS_OK,
+  MODBUS_EXCEPTION,                        // slave returned an exception, see exceptionCode()
+  MODBUS_TIMEOUT,
+  MODBUS_CRC_ERROR,
+  MODBUS_FRAME_ERROR                       // t1.5 gap inside the frame, bad length, address or function
+};
+
+typedef struct {
+  uint32_t requests;
+  uint32_t replies;                        // valid replies, exceptions included
+  uint32_t exceptions;
+  uint32_t timeouts;
+  uint32_t crcErrors;
+  uint32_t frameErrors;
+  uint32_t lastRoundTrip;                  // µs from request to end of reply (t3.5 included)
+  uint32_t maxRoundTrip;
+} ModbusStats;
+
+/*
+ * Non-blocking Modbus RTU master on an extra serial port.
+ *
+ * The TC paired with the port is retriggered by every byte received and
+ * every frame transmitted. Its CC0 match flags t1.5 (inter-character gap)
+ * and its CC1 match flags t3.5 (end of frame / line idle), so neither
+ * flush() nor millis() polling is needed to delimit frames. Since each
+ * port has its own TC, one master per extra port can run at the same time:
+ * issue a request on every port then poll() them all from loop().
+ */
+class ModbusRtuMaster {
+  public:
+    // The port's Uart is started at the given baud rate (8E1 as per the
+    // Modbus specification unless another config is given). dePin, if not
+    // negative, drives the DE input of an RS-485 transceiver. Returns false
+    // if the port or its TC is already used by another add-on library.
+    bool begin(ExtraSerialPort *port, unsigned long baud, uint16_t config = SERIAL_8E1, int dePin = -1);
+    void end();
+
+    // Return false if a request is in progress or t3.5 has not yet elapsed
+    // since the last activity on the line
+    bool request(uint8_t slave, uint8_t function, const uint8_t *data, uint8_t length);
+    bool readHoldingRegisters(uint8_t slave, uint16_t address, uint16_t count);
+    bool writeSingleRegister(uint8_t slave, uint16_t address, uint16_t value);
+
+    // Advances the transaction, must be called often from loop()
+    ModbusStatus poll();
+    bool ready() { return (state != MODBUS_BUSY) && lineIdle; }
+    ModbusStatus status() { return state; }
+
+    const uint8_t *reply() { return rxFrame; }  // complete ADU, CRC included
+    uint16_t replyLength() { return rxLength; }
+    uint8_t exceptionCode() { return rxFrame[2]; }
+    uint16_t getRegister(uint8_t index);       // from a read holding registers reply
+
+    // ms from the end of the request (TXC) to the first byte of the reply,
+    // the end of the reply is then detected by t3.5
+    uint16_t timeout = 100;
+    ModbusStats stats;
+
+  private:
+    static bool sercomHook(void *context);
+    static bool tcHook(void *context);
+    void retrigger();
+    ModbusStatus complete(ModbusStatus result);
+
+    ExtraSerialPort *port = NULL;
+    int dePin = -1;
+    ModbusStatus state = MODBUS_IDLE;
+    uint8_t slave;
+    uint8_t function;
+    uint8_t txFrame[MODBUS_MAX_ADU];
+    uint8_t rxFrame[MODBUS_MAX_ADU];
+    uint16_t rxLength;
+    uint32_t startMicros;
+    volatile uint32_t txDoneMillis;
+    volatile bool txDone;
+    volatile bool inFrame;                 // a byte was received since the last t3.5 or TXC
+    volatile bool pastT15;                 // t1.5 elapsed since the last byte
+    volatile bool gapError;                // byte received after t1.5 but before t3.5
+    volatile bool lineIdle = true;         // t3.5 elapsed since the last activity
+};
@@ -0,0 +1,27 @@
+#include "ModbusSlaveSim.h"
+
+void ModbusSlaveSim::begin(Stream &rx, Stream &tx, uint8_t address, unsigned long baud) {
+    this->rx = &rx;
+    this->tx = &tx;
+    reset(address);
+    t35 = (baud > 19200) ? 1750 : 38500000UL / baud;
+    length = 0;
+}
+
+void ModbusSlaveSim::poll() {
+    while (rx->available()) {
+        int c = rx->read();
+        if (length < sizeof(frame))
+            frame[length++] = c;
+        lastByte = micros();
+    }
+    if (length && (micros() - lastByte >= t35)) {
+        frames++;
+        size_t n = process(frame, length, reply);
+        length = 0;
+        if (n) {
+            tx->write(reply, n);
+            replies++;
+        }
+    }
+}
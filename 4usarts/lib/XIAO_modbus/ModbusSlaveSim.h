@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Arduino.h>
+#include "ModbusSlaveTable.h"
+
+/*
+ * Simulated Modbus RTU slave used to exercise ModbusRtuMaster without
+ * external hardware.
+ *
+ * poll() runs ModbusSlaveTable::process() on a pair of streams (the RX and
+ * TX of a loop can be on different ports) and delimits frames with
+ * micros(), which is good enough for a simulator.
+ */
+class ModbusSlaveSim : public ModbusSlaveTable {
+  public:
+    void begin(Stream &rx, Stream &tx, uint8_t address, unsigned long baud);
+    void poll();
+
+    uint32_t frames = 0;                   // requests received
+    uint32_t replies = 0;                  // replies sent
+
+  private:
+    Stream *rx = NULL;
+    Stream *tx = NULL;
+    uint32_t t35;                          // µs
+    uint32_t lastByte;
+    uint16_t length = 0;
+    uint8_t frame[256];
+    uint8_t reply[256];
+};
@@ -0,0 +1,111 @@
+/*
+ * modbus_bench
+ *
+ * Modbus RTU polls/second benchmark on the extra hardware serial ports
+ * of the Seeeduino XIAO board based on the Sam D21G microcontroller
+ *
+ */
+
+// Copyright 2022, Michel Deslierres, no rights reserved.
+// In those jurisdictions where releasing a work into the public domain may be a problem,
+// the BSD Zero Clause License <https://spdx.org/licenses/0BSD.html> applies.
+// SPDX-License-Identifier: 0BSD
+
+/*
+ * Two ModbusRtuMaster instances, on Serial2 and Serial3, poll two simulated
+ * slaves running on Serial1 and Serial4. Both masters run concurrently, each
+ * one timing its frames with its own TC (TC3 for Serial2, TC4 for Serial3).
+ * With real slaves, a third master can be started on Serial4 (TC5).
+ *
+ * Every second the number of completed polls per master, the round trip
+ * times and the error counters are printed on Serial (= USBSerial).
+ *
+ * Wiring
+ *
+ *   Master Serial2-TX --> Slave Serial1-RX   A10 --> A7
+ *   Slave Serial1-TX --> Master Serial2-RX    A6 --> A9
+ *   Master Serial3-TX --> Slave Serial4-RX    A4 --> SWDIO (PA31)
+ *   Slave Serial4-TX --> Master Serial3-RX  (PA30) SWCLK --> A5
+ *
+ *   See 4usarts.cpp about the variant.cpp changes needed for Serial4.
+ *
+ * To build with PlatformIO, copy this file to ../src/ as modbus_bench.cpp
+ * in place of 4usarts.cpp.
+ */
+
+#include <Arduino.h>            // Needed for PlatformIO
+#include "wiring_private.h"     // for pinPeripheral() function
+#include "Serial2.h"
+#include "Serial3.h"
+#include "Serial4.h"
+#include "ModbusRtu.h"
+#include "ModbusSlaveSim.h"
+
+#define MODBUS_BAUD   115200    // Baud for the Modbus links
+#define REGISTERS     10        // holding registers read by each poll
+
+ModbusRtuMaster master2;
+ModbusRtuMaster master3;
+ModbusSlaveSim slave1;
+ModbusSlaveSim slave4;
+
+uint32_t polls2 = 0;
+uint32_t polls3 = 0;
+
+void setup() {
+  // Wait up to 10 seconds for Serial (= USBSerial) port to come up.
+  unsigned long startserial = millis();
+  while (!Serial && (millis() - startserial < 10000)) ;
+
+  Serial.println("\n\nmodbus_bench");
+  Serial.println("------------");
+
+  Serial1.begin(MODBUS_BAUD, SERIAL_8E1);
+  Serial4.begin(MODBUS_BAUD, SERIAL_8E1);
+  pinPeripheral(PIN_SERIAL4_TX, PIO_SERCOM_ALT);
+  pinPeripheral(PIN_SERIAL4_RX, PIO_SERCOM_ALT);
+  slave1.begin(Serial1, Serial1, 1, MODBUS_BAUD);
+  slave4.begin(Serial4, Serial4, 4, MODBUS_BAUD);
+
+  master2.begin(&Serial2Port, MODBUS_BAUD);
+  master3.begin(&Serial3Port, MODBUS_BAUD);
+
+  Serial.println("Setup completed, starting loop");
+}
+
+// Starts the next poll as soon as the previous one is complete and the
+// line has been idle for t3.5
+void pollNext(ModbusRtuMaster &master, uint8_t slave) {
+  master.poll();
+  if (master.ready())
+    master.readHoldingRegisters(slave, 0, REGISTERS);
+}
+
+void report(const char *name, ModbusRtuMaster &master, uint32_t polls) {
+  Serial.printf("%s: %lu polls/s, round trip %lu us (max %lu), %lu timeouts, %lu CRC errors, %lu frame errors\n",
+    name, polls, master.stats.lastRoundTrip, master.stats.maxRoundTrip,
+    master.stats.timeouts, master.stats.crcErrors, master.stats.frameErrors);
+}
+
+unsigned long reportTimer = millis();
+
+void loop() {
+  slave1.poll();
+  slave4.poll();
+
+  // Polls completed during this pass (exceptions included)
+  uint32_t done2 = master2.stats.replies;
+  uint32_t done3 = master3.stats.replies;
+  pollNext(master2, 1);
+  pollNext(master3, 4);
+  polls2 += master2.stats.replies - done2;
+  polls3 += master3.stats.replies - done3;
+
+  if (millis() - reportTimer >= 1000) {
+    report("Serial2", master2, polls2);
+    report("Serial3", master3, polls3);
+    polls2 = 0;
+    polls3 = 0;
+    reportTimer = millis();
+  }
+}
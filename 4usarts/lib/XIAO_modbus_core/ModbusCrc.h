@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Table-driven Modbus CRC16 (polynomial 0xA001, initial value 0xFFFF).
+// The CRC is sent low byte first.
+uint16_t modbusCrc16(const uint8_t *data, size_t length);
@@ -0,0 +1,65 @@
+#include <string.h>
+#include "ModbusSlaveTable.h"
+#include "ModbusCrc.h"
+
+void ModbusSlaveTable::reset(uint8_t address) {
+    this->address = address;
+    for (int i = 0; i < MODBUS_SIM_REGISTERS; i++)
+        registers[i] = i;
+}
+
+static size_t exception(const uint8_t *request, uint8_t code, uint8_t *reply) {
+    reply[0] = request[0];
+    reply[1] = request[1] | 0x80;
+    reply[2] = code;
+    return 3;
+}
+
+size_t ModbusSlaveTable::process(const uint8_t *request, size_t length, uint8_t *reply) {
+    bool broadcast = (request[0] == 0);
+    if (length < 4 || (request[0] != address && !broadcast))
+        return 0;
+    uint16_t crc = modbusCrc16(request, length - 2);
+    if ((request[length - 2] != (crc & 0xFF)) || (request[length - 1] != (crc >> 8)))
+        return 0;
+
+    size_t n;
+    uint16_t first = 0;
+    uint16_t value = 0;
+    if (length == 8) {
+        first = (request[2] << 8) | request[3];
+        value = (request[4] << 8) | request[5];
+    }
+    if ((request[1] != 0x03) && (request[1] != 0x06))
+        n = exception(request, 0x01, reply);            // illegal function
+    else if (length != 8)
+        n = exception(request, 0x03, reply);            // illegal data value
+    else if (request[1] == 0x03) {
+        if ((value == 0) || (value > 125) || (first + value > MODBUS_SIM_REGISTERS))
+            n = exception(request, 0x02, reply);        // illegal data address
+        else {
+            reply[0] = address;
+            reply[1] = 0x03;
+            reply[2] = 2*value;
+            n = 3;
+            for (uint16_t i = first; i < first + value; i++) {
+                reply[n++] = registers[i] >> 8;
+                reply[n++] = registers[i] & 0xFF;
+            }
+        }
+    } else {
+        if (first >= MODBUS_SIM_REGISTERS)
+            n = exception(request, 0x02, reply);
+        else {
+            registers[first] = value;
+            memcpy(reply, request, 6);                  // echo of the request
+            n = 6;
+        }
+    }
+    if (broadcast)
+        return 0;                                       // carried out, no reply
+    crc = modbusCrc16(reply, n);
+    reply[n++] = crc & 0xFF;
+    reply[n++] = crc >> 8;
+    return n;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define MODBUS_SIM_REGISTERS (64)
+
+/*
+ * Register table and request processing of a simulated Modbus RTU slave.
+ *
+ * Does not depend on the hardware, it is built and checked on the host by
+ * the native unit tests in 4usarts/test/. ModbusSlaveSim adds the serial
+ * transport.
+ *
+ * Supported functions: 0x03 read holding registers, 0x06 write single
+ * register. Anything else gets an illegal function exception.
+ */
+class ModbusSlaveTable {
+  public:
+    // Sets the slave address and fills register i with i
+    void reset(uint8_t address);
+
+    // Builds the reply to a complete request (CRC included) and returns its
+    // length, or 0 if there is no reply (bad CRC, other address). Broadcast
+    // requests (address 0) are carried out but never get a reply.
+    size_t process(const uint8_t *request, size_t length, uint8_t *reply);
+
+    uint16_t registers[MODBUS_SIM_REGISTERS];
+    uint8_t address = 0;
+};
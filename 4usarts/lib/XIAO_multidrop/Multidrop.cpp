@@ -0,0 +1,135 @@
+#include "Multidrop.h"
+#include "wiring_private.h"     // for pinPeripheral() function
+
+#define BUFFER_MASK (MULTIDROP_BUFFER - 1)
+
+bool Multidrop::begin(ExtraSerialPort *port, unsigned long baud, uint8_t address, uint8_t mask, uint8_t broadcast) {
+    if (this->port || port->hook)
+        return false;
+    this->port = port;
+    setFilter(address, mask, broadcast);
+    accepting = false;
+    rxHead = rxTail = 0;
+    txHead = txTail = 0;
+    sent = false;
+    memset(&stats, 0, sizeof(stats));
+
+    port->uart->begin(baud, SERIAL_8N1);
+    pinPeripheral(port->pinTX, PIO_SERCOM_ALT);
+    pinPeripheral(port->pinRX, PIO_SERCOM_ALT);
+    extraSerialDisable(port);
+    port->sercom->USART.CTRLB.bit.CHSIZE = 1;      // 9 bits
+    extraSerialEnable(port);
+    return extraSerialSetHook(port, hook, this);
+}
+
+void Multidrop::end() {
+    if (!port)
+        return;
+    flush();
+    extraSerialSetHook(port, NULL, NULL);
+    port->uart->end();
+    port = NULL;
+}
+
+void Multidrop::setFilter(uint8_t address, uint8_t mask, uint8_t broadcast) {
+    ownAddress = address;
+    this->mask = mask;
+    this->broadcast = broadcast;
+}
+
+int Multidrop::available() {
+    return (rxHead - rxTail) & BUFFER_MASK;
+}
+
+int Multidrop::peek() {
+    if (rxHead == rxTail)
+        return -1;
+    return rxBuffer[rxTail];
+}
+
+int Multidrop::read() {
+    if (rxHead == rxTail)
+        return -1;
+    int c = rxBuffer[rxTail];
+    rxTail = (rxTail + 1) & BUFFER_MASK;
+    return c;
+}
+
+void Multidrop::flush() {
+    while (txHead != txTail) ;
+    // TXC stays 0 until a first character has been sent
+    if (port && sent)
+        while (!port->sercom->USART.INTFLAG.bit.TXC) ;
+}
+
+int Multidrop::availableForWrite() {
+    return MULTIDROP_BUFFER - 1 - ((txHead - txTail) & BUFFER_MASK);
+}
+
+size_t Multidrop::write9(uint16_t data) {
+    uint16_t next = (txHead + 1) & BUFFER_MASK;
+    while (next == txTail) {
+        if ((__get_IPSR() != 0) || (__get_PRIMASK() != 0))
+            return 0;                      // cannot wait for the interrupt handler
+    }
+    txBuffer[txHead] = data;
+    txHead = next;
+    sent = true;
+    port->sercom->USART.INTENSET.reg = SERCOM_USART_INTENSET_DRE;
+    return 1;
+}
+
+size_t Multidrop::write(uint8_t data) {
+    return port ? write9(data) : 0;
+}
+
+size_t Multidrop::writeAddress(uint8_t address) {
+    return port ? write9(MULTIDROP_ADDRESS_BIT | address) : 0;
+}
+
+bool Multidrop::hook(void *context) {
+    Multidrop *md = (Multidrop *) context;
+    SercomUsart *usart = &md->port->sercom->USART;
+    uint8_t flags = usart->INTFLAG.reg;
+
+    if (flags & SERCOM_USART_INTFLAG_ERROR) {
+        usart->INTFLAG.reg = SERCOM_USART_INTFLAG_ERROR;
+        if (usart->STATUS.reg & (SERCOM_USART_STATUS_FERR | SERCOM_USART_STATUS_BUFOVF)) {
+            md->stats.errors++;
+            // Characters were lost on an overrun and one of them may have been
+            // an address: drop everything until the next address
+            md->accepting = false;
+            if (usart->STATUS.bit.FERR) {
+                (void) usart->DATA.reg;    // the character is invalid, and so is the rest of the frame
+                flags &= ~SERCOM_USART_INTFLAG_RXC;
+            }
+        }
+        usart->STATUS.reg = SERCOM_USART_STATUS_MASK;
+    }
+
+    if (flags & SERCOM_USART_INTFLAG_RXC) {
+        uint16_t c = usart->DATA.reg;
+        if (c & MULTIDROP_ADDRESS_BIT)
+            md->accepting = md->matches(c & 0xFF);
+        if (md->accepting) {
+            uint16_t next = (md->rxHead + 1) & BUFFER_MASK;
+            if (next != md->rxTail) {
+                md->rxBuffer[md->rxHead] = c;
+                md->rxHead = next;
+                md->stats.accepted++;
+            } else
+                md->stats.overflows++;
+        } else
+            md->stats.filtered++;
+    }
+
+    if ((flags & SERCOM_USART_INTFLAG_DRE) && (usart->INTENSET.reg & SERCOM_USART_INTENSET_DRE)) {
+        if (md->txHead != md->txTail) {
+            usart->DATA.reg = md->txBuffer[md->txTail];
+            md->txTail = (md->txTail + 1) & BUFFER_MASK;
+        } else
+            usart->INTENCLR.reg = SERCOM_USART_INTENCLR_DRE;
+    }
+    return true;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <Arduino.h>
+#include "ExtraSerial.h"
+
+#define MULTIDROP_BUFFER (128)             // characters per ring, power of 2
+#define MULTIDROP_ADDRESS_BIT (0x100)      // 9th bit, set on address characters
+
+typedef struct {
+  uint32_t accepted;                       // characters stored, address characters included
+  uint32_t filtered;                       // characters discarded in the interrupt handler
+  uint32_t overflows;                      // accepted characters lost because the RX ring was full
+  uint32_t errors;                         // frame errors and SERCOM buffer overflows
+} MultidropStats;
+
+/*
+ * 9-bit multi-drop bus on an extra serial port.
+ *
+ * A character with the 9th bit set is an address. It opens a frame that
+ * is accepted if (address & mask) == (own address & mask) or if the
+ * address is the broadcast id; all characters up to the next address
+ * belong to that frame. Characters of frames addressed to other nodes
+ * are discarded in SERCOMx_Handler and never reach the RX ring. After a
+ * frame error or a SERCOM buffer overflow the rest of the current frame is
+ * discarded as well, since its address may have been lost.
+ *
+ * The hook services the SERCOM entirely, Uart::IrqHandler() is not used
+ * and the Uart must not be written to directly. read() and peek() return
+ * address characters with MULTIDROP_ADDRESS_BIT set.
+ */
+class Multidrop : public Stream {
+  public:
+    // Starts the port's Uart at the given rate with 9 data bits, 1 stop bit.
+    // Returns false if the port is already hooked by another add-on library.
+    bool begin(ExtraSerialPort *port, unsigned long baud, uint8_t address, uint8_t mask = 0xFF, uint8_t broadcast = 0xFF);
+    void end();
+    void setFilter(uint8_t address, uint8_t mask = 0xFF, uint8_t broadcast = 0xFF);
+
+    int available();
+    int peek();
+    int read();
+    void flush();
+    int availableForWrite();
+    size_t write(uint8_t data);
+    size_t writeAddress(uint8_t address);
+    using Print::write;
+
+    MultidropStats stats;
+
+  private:
+    static bool hook(void *context);
+    size_t write9(uint16_t data);
+    bool matches(uint8_t address) {
+      return ((address & mask) == (ownAddress & mask)) || (address == broadcast);
+    }
+
+    ExtraSerialPort *port = NULL;
+    volatile uint8_t ownAddress;
+    volatile uint8_t mask;
+    volatile uint8_t broadcast;
+    volatile bool accepting = false;       // the current frame is for this node
+    uint16_t rxBuffer[MULTIDROP_BUFFER];
+    volatile uint16_t rxHead = 0;
+    volatile uint16_t rxTail = 0;
+    uint16_t txBuffer[MULTIDROP_BUFFER];
+    volatile uint16_t txHead = 0;
+    volatile uint16_t txTail = 0;
+    bool sent = false;
+};
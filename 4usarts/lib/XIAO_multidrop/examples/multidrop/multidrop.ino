@@ -0,0 +1,132 @@
+/*
+ * multidrop
+ *
+ * 9-bit multi-drop bus with address filtering in the interrupt handler
+ * on the Seeeduino XIAO board based on the Sam D21G microcontroller
+ *
+ */
+
+// Copyright 2022, Michel Deslierres, no rights reserved.
+// In those jurisdictions where releasing a work into the public domain may be a problem,
+// the BSD Zero Clause License <https://spdx.org/licenses/0BSD.html> applies.
+// SPDX-License-Identifier: 0BSD
+
+/*
+ * Serial3 plays the bus master and keeps the bus busy with frames sent in
+ * turn to NODES node addresses, one frame in BROADCAST_EVERY going to the
+ * broadcast id. Serial2 is node OWN_ADDRESS.
+ *
+ * Every PHASE seconds Serial2 switches between filtering in the interrupt
+ * handler (mask 0xFF) and accepting everything (mask 0x00) as if the
+ * filtering were done in loop(). In the latter case loop() has to read
+ * and reject the frames for other nodes itself.
+ *
+ * Every second the accepted and filtered character counts and the share
+ * of CPU time spent by loop() on the received characters are printed on
+ * Serial (= USBSerial).
+ *
+ * Wiring
+ *
+ *   Serial3-TX --> Serial2-RX   A4 --> A9
+ *
+ * To build with PlatformIO, copy this file to ../src/ as multidrop.cpp
+ * in place of 4usarts.cpp.
+ */
+
+#include <Arduino.h>            // Needed for PlatformIO
+#include "Serial2.h"
+#include "Serial3.h"
+#include "Multidrop.h"
+
+#define BUS_BAUD          115200    // Baud for the bus
+#define NODES             16        // nodes addressed by the master
+#define OWN_ADDRESS       5         // address of Serial2
+#define BROADCAST         0xFF      // broadcast id
+#define BROADCAST_EVERY   32        // one frame in BROADCAST_EVERY is a broadcast
+#define FRAME_LENGTH      16        // data characters per frame
+#define PHASE             5         // seconds in each filtering mode
+
+Multidrop bus2;                     // node
+Multidrop bus3;                     // master
+
+void setup() {
+  // Wait up to 10 seconds for Serial (= USBSerial) port to come up.
+  unsigned long startserial = millis();
+  while (!Serial && (millis() - startserial < 10000)) ;
+
+  Serial.println("\n\nmultidrop");
+  Serial.println("---------");
+
+  bus2.begin(&Serial2Port, BUS_BAUD, OWN_ADDRESS, 0xFF, BROADCAST);
+  bus3.begin(&Serial3Port, BUS_BAUD, 0, 0xFF, BROADCAST);
+
+  Serial.println("Setup completed, starting loop");
+}
+
+// Master: queue the next frame whenever there is room for it
+uint32_t frameCount = 0;
+
+void sendFrames() {
+  while (bus3.availableForWrite() > FRAME_LENGTH + 1) {
+    uint8_t address = (frameCount % BROADCAST_EVERY == 0) ? BROADCAST : frameCount % NODES;
+    bus3.writeAddress(address);
+    for (int i = 0; i < FRAME_LENGTH; i++)
+      bus3.write('a' + i);
+    frameCount++;
+  }
+}
+
+// Node: consume the received characters, rejecting the frames for other
+// nodes when the interrupt handler does not
+bool filtering = true;
+bool forMe = false;
+uint32_t frames = 0;
+uint32_t rejected = 0;
+uint32_t busyMicros = 0;
+
+void receive() {
+  uint32_t start = micros();
+  int c;
+  while ((c = bus2.read()) >= 0) {
+    if (c & MULTIDROP_ADDRESS_BIT) {
+      uint8_t address = c & 0xFF;
+      forMe = (address == OWN_ADDRESS) || (address == BROADCAST);
+      if (forMe)
+        frames++;
+      else
+        rejected++;
+    }
+    // a real application would process the data characters of its frames here
+  }
+  busyMicros += micros() - start;
+}
+
+unsigned long reportTimer = millis();
+unsigned long phaseTimer = reportTimer;
+MultidropStats lastStats = { 0, 0, 0, 0 };
+
+void loop() {
+  sendFrames();
+  receive();
+
+  if (millis() - phaseTimer >= PHASE*1000UL) {
+    filtering = !filtering;
+    bus2.setFilter(OWN_ADDRESS, filtering ? 0xFF : 0x00, BROADCAST);
+    Serial.printf("\nAddress filtering in the %s\n", filtering ? "interrupt handler" : "loop");
+    phaseTimer = millis();
+  }
+
+  if (millis() - reportTimer >= 1000) {
+    unsigned long elapsed = millis() - reportTimer;
+    MultidropStats s = bus2.stats;
+    Serial.printf("%lu accepted, %lu filtered, %lu overflows, %lu errors; %lu frames, %lu rejected by loop; loop RX CPU %lu.%lu%%\n",
+      s.accepted - lastStats.accepted, s.filtered - lastStats.filtered,
+      s.overflows - lastStats.overflows, s.errors - lastStats.errors, frames, rejected,
+      busyMicros / (elapsed * 10), (busyMicros / elapsed) % 10);
+    lastStats = s;
+    frames = 0;
+    rejected = 0;
+    busyMicros = 0;
+    reportTimer = millis();
+  }
+}
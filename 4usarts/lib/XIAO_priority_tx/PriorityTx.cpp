@@ -0,0 +1,127 @@
+#include "PriorityTx.h"
+
+#define BUFFER_MASK  (PRIORITY_TX_BUFFER - 1)
+#define MESSAGE_MASK (PRIORITY_TX_MESSAGES - 1)
+
+// True in an interrupt handler or with interrupts masked, where waiting
+// for room in a queue would never end
+static bool cannotWait() {
+    return (__get_IPSR() != 0) || (__get_PRIMASK() != 0);
+}
+
+int TxQueue::availableForWrite() {
+    return PRIORITY_TX_BUFFER - 1 - ((head - tail) & BUFFER_MASK);
+}
+
+size_t TxQueue::write(uint8_t c) {
+    while ((availableForWrite() == 0) || (((messageHead + 1) & MESSAGE_MASK) == messageTail)) {
+        if (cannotWait()) {
+            stats.dropped++;
+            return 0;
+        }
+        // The buffer is full of the open message: commit it if the message
+        // ring has a free slot, otherwise wait for a message to be sent
+        if (openLength && (availableForWrite() == 0) && (((messageHead + 1) & MESSAGE_MASK) != messageTail))
+            endMessage();
+    }
+    buffer[head] = c;
+    head = (head + 1) & BUFFER_MASK;
+    openLength++;
+    if ((c == '\n') || (openLength >= maxMessage))
+        endMessage();
+    return 1;
+}
+
+void TxQueue::endMessage() {
+    if (openLength == 0)
+        return;
+    // write() makes sure there is a free message slot before a byte is added
+    messages[messageHead].length = openLength;
+    messages[messageHead].stamp = micros();
+    messageHead = (messageHead + 1) & MESSAGE_MASK;
+    openLength = 0;
+    if (owner)
+        owner->kick();
+}
+
+bool PriorityTx::begin(ExtraSerialPort *port) {
+    if (this->port || port->hook)
+        return false;
+    this->port = port;
+    urgent.owner = this;
+    bulk.owner = this;
+    current = NULL;
+    remaining = 0;
+    return extraSerialSetHook(port, hook, this);
+}
+
+void PriorityTx::end() {
+    if (!port)
+        return;
+    while (current || (urgent.messageHead != urgent.messageTail) || (bulk.messageHead != bulk.messageTail)) ;
+    extraSerialSetHook(port, NULL, NULL);
+    port = NULL;
+}
+
+void PriorityTx::kick() {
+    if (port)
+        port->sercom->USART.INTENSET.reg = SERCOM_USART_INTENSET_DRE;
+}
+
+// Loads the next byte in DATA, returns false if both queues are empty
+bool PriorityTx::serviceDre() {
+    if (remaining == 0) {
+        TxQueue *next = NULL;
+        if (urgent.messageHead != urgent.messageTail)
+            next = &urgent;
+        else if (bulk.messageHead != bulk.messageTail)
+            next = &bulk;
+        current = next;
+        if (!next)
+            return false;
+
+        TxQueue::Message *message = &next->messages[next->messageTail];
+        uint32_t latency = micros() - message->stamp;
+        remaining = message->length;
+        next->messageTail = (next->messageTail + 1) & MESSAGE_MASK;
+        next->stats.messages++;
+        next->stats.lastLatency = latency;
+        next->stats.totalLatency += latency;
+        if (latency > next->stats.maxLatency)
+            next->stats.maxLatency = latency;
+    }
+    port->sercom->USART.DATA.reg = current->buffer[current->tail];
+    current->tail = (current->tail + 1) & BUFFER_MASK;
+    if (--remaining == 0)
+        current = NULL;
+    return true;
+}
+
+bool PriorityTx::hook(void *context) {
+    PriorityTx *ptx = (PriorityTx *) context;
+    SercomUsart *usart = &ptx->port->sercom->USART;
+    uint8_t flags = usart->INTFLAG.reg & usart->INTENSET.reg;
+    bool sending = false;
+
+    // Uart::IrqHandler() sends a byte of the Uart TX ring whenever the DRE
+    // flag is set, whatever INTENSET says. DATA is therefore kept full while
+    // messages remain: DRE can then only be set again one character time
+    // later, long after IrqHandler() has looked at it.
+    if (flags & SERCOM_USART_INTFLAG_DRE) {
+        while ((sending = ptx->serviceDre()) && usart->INTFLAG.bit.DRE) ;
+    }
+
+    // Reception, errors and the Uart's own TX ring (when both queues are
+    // empty) are left to the Uart, with the DRE interrupt masked while a
+    // message is in progress. IrqHandler() disables the DRE interrupt when
+    // its ring is empty, so re-enable it while messages remain.
+    if (!sending || (flags & ~SERCOM_USART_INTFLAG_DRE)) {
+        if (sending)
+            usart->INTENCLR.reg = SERCOM_USART_INTENCLR_DRE;
+        ptx->port->uart->IrqHandler();
+        if (ptx->remaining || (ptx->urgent.messageHead != ptx->urgent.messageTail) ||
+            (ptx->bulk.messageHead != ptx->bulk.messageTail))
+            usart->INTENSET.reg = SERCOM_USART_INTENSET_DRE;
+    }
+    return true;
+}
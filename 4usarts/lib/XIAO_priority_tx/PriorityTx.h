@@ -0,0 +1,86 @@
+#pragma once
+
+#include <Arduino.h>
+#include "ExtraSerial.h"
+
+#define PRIORITY_TX_BUFFER   (256)         // bytes per queue, power of 2
+#define PRIORITY_TX_MESSAGES (16)          // messages waiting per queue, power of 2
+
+class PriorityTx;
+
+typedef struct {
+  uint32_t messages;                       // messages transmitted
+  uint32_t dropped;                        // bytes dropped because the queue was full
+  uint32_t lastLatency;                    // µs from endMessage() to first byte in DATA
+  uint32_t maxLatency;
+  uint64_t totalLatency;                   // totalLatency/messages = average latency
+} TxQueueStats;
+
+/*
+ * One transmit queue. Bytes written to it are held back until the message
+ * is committed with endMessage(), when a '\n' is written, or when the open
+ * message reaches maxMessage bytes. Only committed messages are transmitted,
+ * and a message is never interrupted once its first byte is sent.
+ */
+class TxQueue : public Print {
+  public:
+    size_t write(uint8_t c);
+    using Print::write;
+    void endMessage();
+    int availableForWrite();
+
+    uint16_t maxMessage = PRIORITY_TX_BUFFER/2;
+    TxQueueStats stats;
+
+  private:
+    friend class PriorityTx;
+    typedef struct {
+      uint16_t length;
+      uint32_t stamp;                      // micros() at commit
+    } Message;
+
+    PriorityTx *owner = NULL;
+    uint8_t buffer[PRIORITY_TX_BUFFER];
+    volatile uint16_t head = 0;            // next byte written
+    volatile uint16_t tail = 0;            // next byte transmitted
+    uint16_t openLength = 0;               // bytes written but not committed
+    Message messages[PRIORITY_TX_MESSAGES];
+    volatile uint8_t messageHead = 0;
+    volatile uint8_t messageTail = 0;
+};
+
+/*
+ * Urgent and bulk transmit queues for an extra serial port.
+ *
+ * The DRE interrupt is serviced by a hook in SERCOMx_Handler. When the
+ * current message is done, the oldest committed urgent message is sent
+ * before any bulk message. A control message therefore waits at most for
+ * the end of the bulk message in progress (bulk.maxMessage bytes) plus the
+ * urgent messages queued before it.
+ *
+ * Reception is still handled by Uart::IrqHandler(). Bytes written to the
+ * Uart (SerialN.print...) that go through its TX ring are sent, with the
+ * lowest priority, when both queues are empty. Uart::write() however puts
+ * a byte directly into DATA when its ring is empty and DATA is free, which
+ * can happen between two bytes of a message: do not write to the Uart
+ * while messages are queued.
+ */
+class PriorityTx {
+  public:
+    // Returns false if the port is already hooked by another add-on library
+    bool begin(ExtraSerialPort *port);
+    void end();
+
+    TxQueue urgent;
+    TxQueue bulk;
+
+  private:
+    friend class TxQueue;
+    static bool hook(void *context);
+    bool serviceDre();
+    void kick();
+
+    ExtraSerialPort *port = NULL;
+    TxQueue * volatile current = NULL;     // queue of the message in progress
+    volatile uint16_t remaining = 0;       // bytes left in the message in progress
+};
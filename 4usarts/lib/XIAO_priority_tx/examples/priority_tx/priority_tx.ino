@@ -0,0 +1,148 @@
+/*
+ * priority_tx
+ *
+ * Urgent and bulk transmit queues on an extra hardware serial port
+ * of the Seeeduino XIAO board based on the Sam D21G microcontroller
+ *
+ */
+
+// Copyright 2022, Michel Deslierres, no rights reserved.
+// In those jurisdictions where releasing a work into the public domain may be a problem,
+// the BSD Zero Clause License <https://spdx.org/licenses/0BSD.html> applies.
+// SPDX-License-Identifier: 0BSD
+
+/*
+ * The bulk queue of Serial2 is kept full of forwarded data so that the
+ * link is saturated, while a short control message is sent in the urgent
+ * queue every CONTROL_INTERVAL ms. Serial3 receives everything and counts
+ * the control messages that arrive intact.
+ *
+ * Every second the number of messages, the average and worst-case latency
+ * (from endMessage() to the first byte on the wire) of each queue are
+ * printed on Serial (= USBSerial) along with the worst-case bound for
+ * urgent messages.
+ *
+ * Before the loop starts, a burst of short messages followed by a long one
+ * is written to the bulk queue so that both its message ring and its byte
+ * buffer fill up. write() must wait for room without losing a message.
+ *
+ * Wiring
+ *
+ *   Serial2-TX --> Serial3-RX  A10 --> A5
+ *
+ * To build with PlatformIO, copy this file to ../src/ as priority_tx.cpp
+ * in place of 4usarts.cpp.
+ */
+
+#include <Arduino.h>            // Needed for PlatformIO
+#include "wiring_private.h"     // for pinPeripheral() function
+#include "Serial2.h"
+#include "Serial3.h"
+#include "PriorityTx.h"
+
+#define USART_BAUD        115200    // Baud for USARTs
+#define CONTROL_INTERVAL  50        // ms between control messages
+#define BULK_MESSAGE      64        // bytes per bulk message
+#define BURST_LINES       20        // short messages in the startup burst
+#define BURST_RUN         200       // bytes of the long message ending the burst
+
+PriorityTx serial2Tx;
+
+// More short messages than PRIORITY_TX_MESSAGES and then a long message,
+// committed in pieces of maxMessage bytes, that fills the byte buffer
+// while the message ring is still full.
+void burstCheck() {
+  Serial.print("Burst check... ");
+  for (int i = 0; i < BURST_LINES; i++)
+    serial2Tx.bulk.printf("=burst %02d\n", i);
+  for (int i = 0; i < BURST_RUN; i++)
+    serial2Tx.bulk.write('=');
+  serial2Tx.bulk.write('\n');
+
+  uint32_t expected = BURST_LINES + (BURST_RUN + 1 + serial2Tx.bulk.maxMessage - 1) / serial2Tx.bulk.maxMessage;
+  unsigned long start = millis();
+  while ((serial2Tx.bulk.stats.messages < expected) && (millis() - start < 1000)) ;
+  Serial.printf("%lu of %lu messages sent\n", serial2Tx.bulk.stats.messages, expected);
+
+  delay(50);                    // let the last message go out
+  while (Serial3.available())
+    Serial3.read();
+  serial2Tx.bulk.stats = TxQueueStats();
+}
+
+void setup() {
+  // Wait up to 10 seconds for Serial (= USBSerial) port to come up.
+  unsigned long startserial = millis();
+  while (!Serial && (millis() - startserial < 10000)) ;
+
+  Serial.println("\n\npriority_tx");
+  Serial.println("-----------");
+
+  Serial2.begin(USART_BAUD);
+  pinPeripheral(PIN_SERIAL2_TX, PIO_SERCOM_ALT);
+  pinPeripheral(PIN_SERIAL2_RX, PIO_SERCOM_ALT);
+  Serial3.begin(USART_BAUD);
+  pinPeripheral(PIN_SERIAL3_TX, PIO_SERCOM_ALT);
+  pinPeripheral(PIN_SERIAL3_RX, PIO_SERCOM_ALT);
+
+  serial2Tx.begin(&Serial2Port);
+  burstCheck();
+  serial2Tx.bulk.maxMessage = BULK_MESSAGE;
+
+  Serial.println("Setup completed, starting loop");
+}
+
+void report(const char *name, TxQueueStats &stats) {
+  Serial.printf("%s: %lu messages, latency avg %lu us, max %lu us, %lu bytes dropped\n",
+    name, stats.messages, stats.messages ? (uint32_t) (stats.totalLatency / stats.messages) : 0,
+    stats.maxLatency, stats.dropped);
+}
+
+unsigned long controlTimer = millis();
+unsigned long reportTimer = controlTimer;
+int controlCount = 0;
+int controlReceived = 0;
+char line[32];
+int lineLength = 0;
+bool capturing = false;
+
+void loop() {
+  // Forwarded data: keep the bulk queue full, one byte per pass so that the
+  // loop never blocks
+  static uint8_t data = 'a';
+  if (serial2Tx.bulk.availableForWrite()) {
+    serial2Tx.bulk.write(data);
+    data = (data == 'z') ? 'a' : data + 1;
+  }
+
+  if (millis() - controlTimer >= CONTROL_INTERVAL) {
+    serial2Tx.urgent.printf("#CTRL %d\n", ++controlCount);
+    controlTimer = millis();
+  }
+
+  // Count the control messages that arrive intact on Serial3. Bulk data is
+  // only lower case letters, so a control message starts at '#' and would
+  // contain letters if it had been split by bulk data.
+  while (Serial3.available()) {
+    char c = Serial3.read();
+    if (c == '#') {
+      capturing = true;
+      lineLength = 0;
+    } else if (capturing && (c == '\n')) {
+      line[lineLength] = 0;
+      if ((strncmp(line, "CTRL ", 5) == 0) && line[5] && (strspn(line + 5, "0123456789") == strlen(line + 5)))
+        controlReceived++;
+      capturing = false;
+    } else if (capturing && (lineLength < (int) sizeof(line) - 1))
+      line[lineLength++] = c;
+  }
+
+  if (millis() - reportTimer >= 1000) {
+    report("urgent", serial2Tx.urgent.stats);
+    report("bulk  ", serial2Tx.bulk.stats);
+    // one bulk message in progress plus the urgent message itself, 10 bits per character
+    Serial.printf("urgent bound %lu us, %d/%d control messages received\n\n",
+      (uint32_t) ((BULK_MESSAGE + 16) * 10000000UL / USART_BAUD), controlReceived, controlCount);
+    reportTimer = millis();
+  }
+}
@@ -0,0 +1,317 @@
+#include "SercomRoles.h"
+
+#define PMUX_SERCOM_ALT   (3)              // peripheral function D
+#define I2C_TIMEOUT       (10000)          // µs
+#define I2C_RISE_TIME_NS  (125)            // same as the Wire library
+
+// SysTick counts down from LOAD to 0 once per millisecond, so its value
+// only gives the elapsed cycles below 1 ms. Longer switches (waiting for the
+// UART transmitter at low baud rates or for an I²C stop) are timed with
+// micros(), COUNTFLAG would only tell that SysTick wrapped, not how often.
+static uint32_t elapsedCycles(uint32_t startVal, uint32_t startMicros) {
+    uint32_t now = SysTick->VAL;
+    uint32_t elapsed = micros() - startMicros;
+    if (elapsed >= 500)
+        return elapsed * (SystemCoreClock / 1000000);
+    uint32_t reload = SysTick->LOAD + 1;
+    return (startVal >= now) ? startVal - now : startVal + reload - now;
+}
+
+bool SercomRoles::begin(ExtraSerialPort *port, unsigned long baud) {
+    if (this->port || port->hook)
+        return false;
+    this->port = port;
+    charMicros = 11000000UL / baud + 1;    // longest frame: 1 + 8 + parity + 1
+    memset(contexts, 0, sizeof(contexts));
+    memset(&stats, 0, sizeof(stats));
+    contexts[SERCOM_ROLE_UART].valid = true;
+    current = SERCOM_ROLE_UART;
+    return extraSerialSetHook(port, hook, this);
+}
+
+void SercomRoles::end() {
+    if (!port)
+        return;
+    switchTo(SERCOM_ROLE_UART);
+    extraSerialSetHook(port, NULL, NULL);
+    port = NULL;
+}
+
+void SercomRoles::addPin(RoleContext *ctx, uint8_t pin, uint8_t pmux, uint8_t pincfg) {
+    if (ctx->pinCount >= SERCOM_ROLE_MAX_PINS)
+        return;
+    PinContext *p = &ctx->pins[ctx->pinCount++];
+    p->group = g_APinDescription[pin].ulPort;
+    p->pin = g_APinDescription[pin].ulPin;
+    p->pmux = pmux;
+    p->pincfg = pincfg;
+
+    // The UART role restores the pins used by the other roles as they are now
+    RoleContext *uart = &contexts[SERCOM_ROLE_UART];
+    for (uint8_t i = 0; i < uart->pinCount; i++)
+        if ((uart->pins[i].group == p->group) && (uart->pins[i].pin == p->pin))
+            return;
+    if (uart->pinCount < SERCOM_ROLE_MAX_PINS) {
+        PinContext *u = &uart->pins[uart->pinCount++];
+        PortGroup *group = &PORT->Group[p->group];
+        u->group = p->group;
+        u->pin = p->pin;
+        u->pincfg = group->PINCFG[p->pin].reg;
+        u->pmux = (group->PMUX[p->pin >> 1].reg >> ((p->pin & 1) * 4)) & 0x0F;
+    }
+}
+
+void SercomRoles::addI2c(uint8_t pinSDA, uint8_t pinSCL, uint32_t clock) {
+    RoleContext *ctx = &contexts[SERCOM_ROLE_I2C];
+    ctx->ctrla = SERCOM_I2CM_CTRLA_MODE_I2C_MASTER;
+    ctx->ctrlb = 0;                        // no smart mode, ACK/NACK and stop are explicit commands
+    ctx->baud = SystemCoreClock / (2 * clock) - 5 - (((SystemCoreClock / 1000000) * I2C_RISE_TIME_NS) / (2 * 1000));
+    ctx->inten = 0;
+    ctx->pinCount = 0;
+    addPin(ctx, pinSDA, PMUX_SERCOM_ALT, PORT_PINCFG_PMUXEN | PORT_PINCFG_INEN);
+    addPin(ctx, pinSCL, PMUX_SERCOM_ALT, PORT_PINCFG_PMUXEN | PORT_PINCFG_INEN);
+    ctx->valid = true;
+}
+
+void SercomRoles::addSpi(uint8_t pinSCK, uint8_t pinMOSI, uint8_t pinMISO, SercomSpiTXPad padTX,
+                         SercomRXPad padRX, uint32_t clock, uint8_t mode) {
+    RoleContext *ctx = &contexts[SERCOM_ROLE_SPI];
+    ctx->ctrla = SERCOM_SPI_CTRLA_MODE_SPI_MASTER | SERCOM_SPI_CTRLA_DOPO(padTX) | SERCOM_SPI_CTRLA_DIPO(padRX) |
+        ((mode & 2) ? SERCOM_SPI_CTRLA_CPOL : 0) | ((mode & 1) ? SERCOM_SPI_CTRLA_CPHA : 0);
+    ctx->ctrlb = SERCOM_SPI_CTRLB_RXEN;
+    ctx->baud = SystemCoreClock / (2 * clock) - 1;
+    ctx->inten = 0;
+    ctx->pinCount = 0;
+    addPin(ctx, pinSCK, PMUX_SERCOM_ALT, PORT_PINCFG_PMUXEN);
+    addPin(ctx, pinMOSI, PMUX_SERCOM_ALT, PORT_PINCFG_PMUXEN);
+    addPin(ctx, pinMISO, PMUX_SERCOM_ALT, PORT_PINCFG_PMUXEN | PORT_PINCFG_INEN);
+    ctx->valid = true;
+}
+
+void SercomRoles::applyPins(const RoleContext *ctx) {
+    for (uint8_t i = 0; i < ctx->pinCount; i++) {
+        const PinContext *p = &ctx->pins[i];
+        PortGroup *group = &PORT->Group[p->group];
+        uint8_t shift = (p->pin & 1) * 4;
+        group->PMUX[p->pin >> 1].reg = (group->PMUX[p->pin >> 1].reg & ~(0x0F << shift)) | (p->pmux << shift);
+        group->PINCFG[p->pin].reg = p->pincfg;
+    }
+}
+
+// Called with the SERCOM interrupt disabled
+void SercomRoles::leaveUart() {
+    SercomUsart *usart = &port->sercom->USART;
+    RoleContext *ctx = &contexts[SERCOM_ROLE_UART];
+
+    // Received bytes still in the SERCOM go to the Uart ring
+    while (usart->INTFLAG.bit.RXC) {
+        port->uart->IrqHandler();
+        stats.rxDrained++;
+    }
+    ctx->inten = usart->INTENSET.reg;
+    usart->INTENCLR.reg = SERCOM_USART_INTENCLR_MASK;
+
+    // TXC is cleared by a write to DATA and set when DATA and the shift
+    // register are both empty. It is also 0 when nothing was sent since the
+    // SERCOM was enabled or since the I²C or SPI role used the same flag,
+    // so a byte is only known to be in flight while DATA is full. Once DATA
+    // is empty, the shift register needs at most one character time.
+    uint32_t start = micros();
+    while (!usart->INTFLAG.bit.TXC && !usart->INTFLAG.bit.DRE) {
+        if (micros() - start > 2*charMicros) {
+            stats.txTimeouts++;
+            break;
+        }
+    }
+    start = micros();
+    while (!usart->INTFLAG.bit.TXC && (micros() - start <= charMicros)) ;
+
+    // Save the context as it is now, the baud rate may have been changed
+    extraSerialDisable(port);
+    ctx->ctrla = usart->CTRLA.reg & ~SERCOM_USART_CTRLA_ENABLE;
+    ctx->ctrlb = usart->CTRLB.reg;
+    ctx->baud = usart->BAUD.reg;
+}
+
+// Called with the SERCOM interrupt disabled and the SERCOM disabled
+void SercomRoles::enterUart() {
+    SercomUsart *usart = &port->sercom->USART;
+    RoleContext *ctx = &contexts[SERCOM_ROLE_UART];
+
+    usart->CTRLA.reg = ctx->ctrla;
+    usart->CTRLB.reg = ctx->ctrlb;
+    usart->BAUD.reg = ctx->baud;
+    applyPins(ctx);
+    extraSerialEnable(port);
+    // TXC is left set so that the next leaveUart() does not wait if nothing was sent
+    usart->INTFLAG.reg = SERCOM_USART_INTFLAG_MASK & ~SERCOM_USART_INTFLAG_TXC;
+    checkFirst = true;
+    // The DRE interrupt is in the saved context if the TX ring was not empty
+    usart->INTENSET.reg = ctx->inten;
+}
+
+bool SercomRoles::switchTo(SercomRole role) {
+    if (!port || (role >= SERCOM_ROLE_COUNT) || !contexts[role].valid)
+        return false;
+    if (role == current)
+        return true;
+
+    uint32_t startMicros = micros();
+    uint32_t start = SysTick->VAL;
+    NVIC_DisableIRQ(port->irqn);
+
+    if (current == SERCOM_ROLE_UART)
+        leaveUart();
+    else {
+        if (current == SERCOM_ROLE_I2C)
+            i2cStop();
+        port->sercom->I2CM.CTRLA.bit.ENABLE = 0;  // ENABLE is at the same place in all modes
+        while (port->sercom->I2CM.SYNCBUSY.bit.ENABLE) ;
+    }
+
+    if (role == SERCOM_ROLE_UART)
+        enterUart();
+    else {
+        RoleContext *ctx = &contexts[role];
+        Sercom *sercom = port->sercom;
+        if (role == SERCOM_ROLE_I2C) {
+            sercom->I2CM.CTRLA.reg = ctx->ctrla;
+            sercom->I2CM.CTRLB.reg = ctx->ctrlb;
+            sercom->I2CM.BAUD.reg = ctx->baud;
+        } else {
+            sercom->SPI.CTRLA.reg = ctx->ctrla;
+            sercom->SPI.CTRLB.reg = ctx->ctrlb;
+            while (sercom->SPI.SYNCBUSY.bit.CTRLB) ;
+            sercom->SPI.BAUD.reg = ctx->baud;
+        }
+        applyPins(ctx);
+        sercom->I2CM.CTRLA.bit.ENABLE = 1;
+        while (sercom->I2CM.SYNCBUSY.bit.ENABLE) ;
+        if (role == SERCOM_ROLE_I2C) {
+            sercom->I2CM.STATUS.bit.BUSSTATE = 1;     // force the bus state to idle
+            while (sercom->I2CM.SYNCBUSY.bit.SYSOP) ;
+        }
+        sercom->I2CM.INTFLAG.reg = SERCOM_I2CM_INTFLAG_MASK;
+    }
+
+    current = role;
+    NVIC_ClearPendingIRQ(port->irqn);
+    NVIC_EnableIRQ(port->irqn);
+
+    uint32_t cycles = elapsedCycles(start, startMicros);
+    stats.switches++;
+    stats.lastCycles = cycles;
+    if (cycles > stats.maxCycles)
+        stats.maxCycles = cycles;
+    return true;
+}
+
+bool SercomRoles::hook(void *context) {
+    SercomRoles *roles = (SercomRoles *) context;
+    if (roles->current != SERCOM_ROLE_UART) {
+        // Not a UART, keep Uart::IrqHandler() out. The only interrupt source
+        // is a stray Uart::write(), which sets INTENSET bit 0 (DRE in USART,
+        // MB in I2CM, DRE in SPI): disable it or the interrupt never ends.
+        Sercom *sercom = roles->port->sercom;
+        if (roles->current == SERCOM_ROLE_I2C) {
+            sercom->I2CM.INTENCLR.reg = SERCOM_I2CM_INTENCLR_MASK;
+            sercom->I2CM.INTFLAG.reg = SERCOM_I2CM_INTFLAG_MASK;
+        } else {
+            sercom->SPI.INTENCLR.reg = SERCOM_SPI_INTENCLR_MASK;
+            sercom->SPI.INTFLAG.reg = SERCOM_SPI_INTFLAG_MASK;
+        }
+        return true;
+    }
+
+    SercomUsart *usart = &roles->port->sercom->USART;
+    if (roles->checkFirst && (usart->INTFLAG.reg & (SERCOM_USART_INTFLAG_RXC | SERCOM_USART_INTFLAG_ERROR))) {
+        if (usart->STATUS.reg & (SERCOM_USART_STATUS_FERR | SERCOM_USART_STATUS_PERR | SERCOM_USART_STATUS_BUFOVF))
+            roles->stats.rxErrors++;
+        roles->checkFirst = false;
+    }
+    return false;
+}
+
+bool SercomRoles::i2cWait(uint8_t flag) {
+    SercomI2cm *i2c = &port->sercom->I2CM;
+    uint32_t start = micros();
+    while (!(i2c->INTFLAG.reg & flag)) {
+        if (i2c->STATUS.bit.BUSERR || i2c->STATUS.bit.ARBLOST || (micros() - start > I2C_TIMEOUT))
+            return false;
+    }
+    return true;
+}
+
+bool SercomRoles::i2cStart(uint8_t address, bool read) {
+    SercomI2cm *i2c = &port->sercom->I2CM;
+    i2c->CTRLB.reg = 0;
+    while (i2c->SYNCBUSY.bit.SYSOP) ;
+    i2c->ADDR.bit.ADDR = (address << 1) | (read ? 1 : 0);
+    while (i2c->SYNCBUSY.bit.SYSOP) ;
+    // A read sets SB once the first byte is in, but MB if the address is
+    // not acknowledged
+    uint8_t flags = SERCOM_I2CM_INTFLAG_MB | (read ? SERCOM_I2CM_INTFLAG_SB : 0);
+    if (!i2cWait(flags) || i2c->STATUS.bit.RXNACK || (read && !i2c->INTFLAG.bit.SB)) {
+        i2cStop();
+        return false;
+    }
+    return true;
+}
+
+void SercomRoles::i2cStop() {
+    SercomI2cm *i2c = &port->sercom->I2CM;
+    if (i2c->STATUS.bit.BUSSTATE != 2)     // only when we own the bus
+        return;
+    i2c->CTRLB.reg = SERCOM_I2CM_CTRLB_CMD(3);
+    while (i2c->SYNCBUSY.bit.SYSOP) ;
+}
+
+bool SercomRoles::i2cWrite(uint8_t address, const uint8_t *data, size_t length, bool stop) {
+    if (current != SERCOM_ROLE_I2C || !i2cStart(address, false))
+        return false;
+    SercomI2cm *i2c = &port->sercom->I2CM;
+    for (size_t i = 0; i < length; i++) {
+        i2c->DATA.bit.DATA = data[i];
+        while (i2c->SYNCBUSY.bit.SYSOP) ;
+        if (!i2cWait(SERCOM_I2CM_INTFLAG_MB) || i2c->STATUS.bit.RXNACK) {
+            i2cStop();
+            return false;
+        }
+    }
+    if (stop)
+        i2cStop();
+    return true;
+}
+
+bool SercomRoles::i2cRead(uint8_t address, uint8_t *data, size_t length) {
+    if (current != SERCOM_ROLE_I2C || !length || !i2cStart(address, true))
+        return false;
+    SercomI2cm *i2c = &port->sercom->I2CM;
+    // i2cStart() waited for the first byte, the clock is held until a command
+    for (size_t i = 0; i < length; i++) {
+        if ((i > 0) && !i2cWait(SERCOM_I2CM_INTFLAG_SB)) {
+            i2cStop();
+            return false;
+        }
+        data[i] = i2c->DATA.bit.DATA;
+        if (i == length - 1)
+            i2c->CTRLB.reg = SERCOM_I2CM_CTRLB_ACKACT | SERCOM_I2CM_CTRLB_CMD(3);   // NACK and stop
+        else
+            i2c->CTRLB.reg = SERCOM_I2CM_CTRLB_CMD(2);                              // ACK and read next
+        while (i2c->SYNCBUSY.bit.SYSOP) ;
+    }
+    return true;
+}
+
+bool SercomRoles::i2cReadRegisters(uint8_t address, uint8_t reg, uint8_t *data, size_t length) {
+    return i2cWrite(address, &reg, 1, false) && i2cRead(address, data, length);
+}
+
+uint8_t SercomRoles::spiTransfer(uint8_t data) {
+    if (current != SERCOM_ROLE_SPI)
+        return 0xFF;
+    SercomSpi *spi = &port->sercom->SPI;
+    spi->DATA.reg = data;
+    while (!spi->INTFLAG.bit.RXC) ;
+    return spi->DATA.reg;
+}
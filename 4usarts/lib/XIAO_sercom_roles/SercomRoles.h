@@ -0,0 +1,116 @@
+#pragma once
+
+#include <Arduino.h>
+#include "ExtraSerial.h"
+
+#define SERCOM_ROLE_MAX_PINS (4)
+
+enum SercomRole : uint8_t {
+  SERCOM_ROLE_UART,
+  SERCOM_ROLE_I2C,                         // I²C master
+  SERCOM_ROLE_SPI,                         // SPI master
+  SERCOM_ROLE_COUNT
+};
+
+typedef struct {
+  uint32_t switches;
+  uint32_t lastCycles;                     // CPU cycles (48 per µs) taken by the last switch, from micros() above 500 µs
+  uint32_t maxCycles;
+  uint32_t rxDrained;                      // bytes moved from the SERCOM to the Uart ring on leaving the UART role
+  uint32_t rxErrors;                       // first bytes with an error after returning to the UART role, see below
+  uint32_t txTimeouts;                     // UART DATA register not emptied in time, a character may be cut
+} SercomRoleStats;
+
+/*
+ * Time-sharing of an extra port's SERCOM between the UART and an I²C or
+ * SPI master role.
+ *
+ * The register context (CTRLA, CTRLB, BAUD, INTEN) and the pin
+ * multiplexing of each role are set up once. A switch then only disables
+ * the SERCOM, writes the other context and enables it again, which takes
+ * microseconds instead of the SWRST, clock setup and pinPeripheral() calls
+ * of a full begin()/end() sequence.
+ *
+ * The Uart object is not touched: bytes in its RX and TX rings survive
+ * the switch and transmission resumes on return to the UART role. Before
+ * leaving that role, received bytes still in the SERCOM are moved to the
+ * Uart ring and the character being sent is allowed to complete.
+ *
+ * While in the I²C or SPI role, the SERCOMx_Handler hook keeps
+ * Uart::IrqHandler() away from the registers and the transfers below are
+ * polled.
+ *
+ * The UART receiver is off while another role is active: bytes sent to the
+ * port then are lost and are not counted. Only the first byte after the
+ * return to the UART role is checked, a byte whose start bit came before
+ * the switch ends with a frame error and is counted in rxErrors. The other
+ * end of the link must not send while the port is in another role.
+ *
+ * Do not write to the Uart (SerialN.write(), print()...) while another
+ * role is active: Uart::write() goes straight to the registers, which
+ * are then the I²C or SPI ones, and would inject a byte in the transfer.
+ * The hook only disables the interrupt such a write enables. Check that
+ * role() is SERCOM_ROLE_UART first, or only write between switchTo() calls
+ * that restore the UART role as the role_switch example does.
+ */
+class SercomRoles {
+  public:
+    // The port's Uart must have been started at the given baud rate.
+    // Returns false if the port is already hooked by another add-on library.
+    bool begin(ExtraSerialPort *port, unsigned long baud);
+    void end();
+
+    // Prepare the I²C or SPI role. The SERCOM pads are given by the pins:
+    // SDA must be on PAD0 and SCL on PAD1 (A4 and A5 for Serial3).
+    void addI2c(uint8_t pinSDA, uint8_t pinSCL, uint32_t clock = 100000);
+    void addSpi(uint8_t pinSCK, uint8_t pinMOSI, uint8_t pinMISO, SercomSpiTXPad padTX,
+                SercomRXPad padRX, uint32_t clock = 1000000, uint8_t mode = 0);
+
+    bool switchTo(SercomRole role);
+    SercomRole role() { return current; }
+
+    // Polled I²C master transfers, return false on NACK or bus error
+    bool i2cWrite(uint8_t address, const uint8_t *data, size_t length, bool stop = true);
+    bool i2cRead(uint8_t address, uint8_t *data, size_t length);
+    bool i2cReadRegisters(uint8_t address, uint8_t reg, uint8_t *data, size_t length);
+
+    // Polled SPI master transfer
+    uint8_t spiTransfer(uint8_t data);
+
+    static uint32_t cyclesToMicros(uint32_t cycles) { return cycles / (SystemCoreClock / 1000000); }
+
+    SercomRoleStats stats;
+
+  private:
+    typedef struct {
+      uint8_t group;
+      uint8_t pin;
+      uint8_t pincfg;
+      uint8_t pmux;                        // peripheral function (PMUXE/PMUXO nibble)
+    } PinContext;
+
+    typedef struct {
+      bool valid;
+      uint32_t ctrla;                      // ENABLE cleared
+      uint32_t ctrlb;
+      uint32_t baud;
+      uint8_t inten;
+      uint8_t pinCount;
+      PinContext pins[SERCOM_ROLE_MAX_PINS];
+    } RoleContext;
+
+    static bool hook(void *context);
+    void addPin(RoleContext *ctx, uint8_t pin, uint8_t pmux, uint8_t pincfg);
+    void applyPins(const RoleContext *ctx);
+    void leaveUart();
+    void enterUart();
+    bool i2cWait(uint8_t flag);
+    bool i2cStart(uint8_t address, bool read);
+    void i2cStop();
+
+    ExtraSerialPort *port = NULL;
+    uint32_t charMicros;
+    SercomRole current = SERCOM_ROLE_UART;
+    RoleContext contexts[SERCOM_ROLE_COUNT];
+    volatile bool checkFirst = false;      // check the first byte received after a switch
+};
@@ -0,0 +1,119 @@
+/*
+ * role_switch
+ *
+ * Time-sharing SERCOM2 between Serial3 and an I²C master on the Seeeduino
+ * XIAO board based on the Sam D21G microcontroller
+ *
+ */
+
+// Copyright 2022, Michel Deslierres, no rights reserved.
+// In those jurisdictions where releasing a work into the public domain may be a problem,
+// the BSD Zero Clause License <https://spdx.org/licenses/0BSD.html> applies.
+// SPDX-License-Identifier: 0BSD
+
+/*
+ * Serial3 uses A4 and A5 which are also the SDA and SCL pins of the XIAO.
+ * Every SENSOR_INTERVAL ms the sketch switches SERCOM2 to the I²C role,
+ * reads one register of an I²C device and switches back to the UART role.
+ * Serial3 keeps transmitting a counter in between; bytes still in its TX
+ * ring when the switch happens are sent once the UART role is restored.
+ * Serial3 is only written to while SERCOM2 is in the UART role, writing to
+ * it in the I²C role would corrupt the I²C transfer.
+ *
+ * Every second, the switch latency (UART to I²C and back), the bytes moved
+ * to the Uart ring on leaving the UART role and the errors seen on the first
+ * byte received after a switch are printed on Serial (= USBSerial). The
+ * time taken by Serial3.end(), Serial3.begin() and pinPeripheral() is
+ * measured once in setup() for comparison.
+ *
+ * Wiring
+ *
+ *   I²C device with pull-ups   SDA --> A4, SCL --> A5
+ *   Serial3-TX                 A4, shared with SDA
+ *   Serial3-RX                 A5, shared with SCL
+ *
+ *   The UART peer must not drive A5 while the I²C role is active, which
+ *   a real design would ensure with a bus switch or a protocol.
+ *
+ * To build with PlatformIO, copy this file to ../src/ as role_switch.cpp
+ * in place of 4usarts.cpp.
+ */
+
+#include <Arduino.h>            // Needed for PlatformIO
+#include "wiring_private.h"     // for pinPeripheral() function
+#include "Serial3.h"
+#include "SercomRoles.h"
+
+#define USART_BAUD        115200    // Baud for USARTs
+#define SENSOR_INTERVAL   100       // ms between I²C reads
+#define I2C_ADDRESS       0x68      // I²C device to read
+#define I2C_REGISTER      0x75      // register to read (WHO_AM_I of many IMUs)
+
+SercomRoles roles3;
+uint32_t reinitMicros;
+
+void setup() {
+  // Wait up to 10 seconds for Serial (= USBSerial) port to come up.
+  unsigned long startserial = millis();
+  while (!Serial && (millis() - startserial < 10000)) ;
+
+  Serial.println("\n\nrole_switch");
+  Serial.println("-----------");
+
+  Serial3.begin(USART_BAUD);
+  pinPeripheral(PIN_SERIAL3_TX, PIO_SERCOM_ALT);
+  pinPeripheral(PIN_SERIAL3_RX, PIO_SERCOM_ALT);
+
+  // Cost of the usual way of giving the SERCOM back to the UART
+  uint32_t start = micros();
+  Serial3.end();
+  Serial3.begin(USART_BAUD);
+  pinPeripheral(PIN_SERIAL3_TX, PIO_SERCOM_ALT);
+  pinPeripheral(PIN_SERIAL3_RX, PIO_SERCOM_ALT);
+  reinitMicros = micros() - start;
+
+  roles3.begin(&Serial3Port, USART_BAUD);
+  roles3.addI2c(PIN_SERIAL3_TX, PIN_SERIAL3_RX);
+
+  Serial.println("Setup completed, starting loop");
+}
+
+unsigned long sensorTimer = millis();
+unsigned long reportTimer = sensorTimer;
+uint32_t toI2cCycles = 0;
+uint32_t toUartCycles = 0;
+uint32_t reads = 0;
+uint32_t readErrors = 0;
+uint32_t counter = 0;
+uint8_t lastValue = 0;
+
+void loop() {
+  if (Serial3.availableForWrite() > 16)
+    Serial3.printf("%lu\n", counter++);
+
+  if (millis() - sensorTimer >= SENSOR_INTERVAL) {
+    roles3.switchTo(SERCOM_ROLE_I2C);
+    toI2cCycles = roles3.stats.lastCycles;
+    if (roles3.i2cReadRegisters(I2C_ADDRESS, I2C_REGISTER, &lastValue, 1))
+      reads++;
+    else
+      readErrors++;
+    roles3.switchTo(SERCOM_ROLE_UART);
+    toUartCycles = roles3.stats.lastCycles;
+    sensorTimer = millis();
+  }
+
+  while (Serial3.available())
+    Serial3.read();
+
+  if (millis() - reportTimer >= 1000) {
+    SercomRoleStats &s = roles3.stats;
+    Serial.printf("switch to I2C %lu us, to UART %lu us, max %lu us (end/begin %lu us)\n",
+      SercomRoles::cyclesToMicros(toI2cCycles), SercomRoles::cyclesToMicros(toUartCycles),
+      SercomRoles::cyclesToMicros(s.maxCycles), reinitMicros);
+    Serial.printf("%lu switches, %lu RX bytes drained, %lu RX errors, %lu TX timeouts\n",
+      s.switches, s.rxDrained, s.rxErrors, s.txTimeouts);
+    Serial.printf("%lu I2C reads (last 0x%02X), %lu errors\n\n", reads, lastValue, readErrors);
+    reportTimer = millis();
+  }
+}
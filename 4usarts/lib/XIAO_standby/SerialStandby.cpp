@@ -0,0 +1,221 @@
+#include "SerialStandby.h"
+
+SerialStandby *SerialStandby::ports[STANDBY_MAX_PORTS];
+uint8_t SerialStandby::portCount = 0;
+bool SerialStandby::prepared = false;
+
+bool SerialStandby::begin(ExtraSerialPort *port, unsigned long baud) {
+    if ((portCount >= STANDBY_MAX_PORTS) || this->port || port->hook)
+        return false;
+    this->port = port;
+
+    // start bit + data bits + parity + stop bit(s), the stop bit is sampled
+    // in its middle
+    SercomUsart *usart = &port->sercom->USART;
+    uint8_t chsize = usart->CTRLB.bit.CHSIZE;     // 0: 8 bits, 1: 9 bits, 5 to 7: 5 to 7 bits
+    uint32_t bits = 1 + ((chsize == 0) ? 8 : (chsize == 1) ? 9 : chsize);
+    if (usart->CTRLA.bit.FORM == 1)
+        bits++;
+    if (usart->CTRLB.bit.SBMODE)
+        bits++;
+    frameMicros = (uint32_t) ((bits * 2 + 1) * 500000UL / baud);
+
+    memset(&stats, 0, sizeof(stats));
+    memset(&awakeStats, 0, sizeof(awakeStats));
+
+    prepareStandby();
+    extraSerialDisable(port);
+    usart->CTRLA.bit.RUNSTDBY = 1;
+    usart->CTRLB.bit.SFDE = 1;
+    extraSerialEnable(port);
+    extraSerialSetHook(port, hook, this);
+    ports[portCount++] = this;
+    return true;
+}
+
+void SerialStandby::end() {
+    if (!port)
+        return;
+    extraSerialSetHook(port, NULL, NULL);
+    SercomUsart *usart = &port->sercom->USART;
+    usart->INTENCLR.reg = SERCOM_USART_INTENCLR_RXS;
+    extraSerialDisable(port);
+    usart->CTRLA.bit.RUNSTDBY = 0;
+    usart->CTRLB.bit.SFDE = 0;
+    extraSerialEnable(port);
+
+    for (uint8_t i = 0; i < portCount; i++) {
+        if (ports[i] == this) {
+            ports[i] = ports[--portCount];
+            break;
+        }
+    }
+    port = NULL;
+}
+
+// Clock and NVM setup needed by every sleep()
+void SerialStandby::prepareStandby() {
+    if (prepared)
+        return;
+    prepared = true;
+
+    // GCLK0, which clocks the core and the SERCOMs, is fed by the DFLL48M;
+    // both keep running in standby unless setClockOnDemand(true) is called
+    while (!SYSCTRL->PCLKSR.bit.DFLLRDY) ;
+    SYSCTRL->DFLLCTRL.reg = (uint16_t) ((SYSCTRL->DFLLCTRL.reg | SYSCTRL_DFLLCTRL_RUNSTDBY) & ~SYSCTRL_DFLLCTRL_ONDEMAND);
+    while (!SYSCTRL->PCLKSR.bit.DFLLRDY) ;
+
+    // Keep GCLK0 running in standby so that the SERCOM clock request reaches the DFLL
+    *((uint8_t *) &GCLK->GENCTRL.reg) = 0;
+    while (GCLK->STATUS.bit.SYNCBUSY) ;
+    GCLK->GENCTRL.reg |= GCLK_GENCTRL_RUNSTDBY;
+    while (GCLK->STATUS.bit.SYNCBUSY) ;
+
+    // Errata: the device may not wake from standby with the NVM in its
+    // default power reduction mode
+    NVMCTRL->CTRLB.bit.SLEEPPRM = NVMCTRL_CTRLB_SLEEPPRM_DISABLED_Val;
+}
+
+void SerialStandby::setClockOnDemand(bool onDemand) {
+    prepareStandby();
+    while (!SYSCTRL->PCLKSR.bit.DFLLRDY) ;
+    uint16_t dfllctrl = SYSCTRL->DFLLCTRL.reg;
+    if (onDemand)
+        dfllctrl |= SYSCTRL_DFLLCTRL_ONDEMAND;
+    else
+        dfllctrl &= ~SYSCTRL_DFLLCTRL_ONDEMAND;
+    SYSCTRL->DFLLCTRL.reg = dfllctrl;
+    while (!SYSCTRL->PCLKSR.bit.DFLLRDY) ;
+}
+
+void SerialStandby::record(StandbyStats *target, bool intact, uint32_t elapsed) {
+    if (!intact) {
+        target->lost++;
+        return;
+    }
+    if (rxcAtRxs) {                        // latency >= frameMicros, unknown
+        target->saturated++;
+        return;
+    }
+    uint32_t latency = (frameMicros > elapsed) ? frameMicros - elapsed : 0;
+    target->firstBytes++;
+    target->lastLatency = latency;
+    target->totalLatency += latency;
+    if (latency > target->maxLatency)
+        target->maxLatency = latency;
+}
+
+bool SerialStandby::hook(void *context) {
+    SerialStandby *sb = (SerialStandby *) context;
+    SercomUsart *usart = &sb->port->sercom->USART;
+
+    if (usart->INTFLAG.bit.RXS && sb->armed) {
+        sb->rxsMicros = micros();
+        sb->rxcAtRxs = usart->INTFLAG.bit.RXC;
+        usart->INTENCLR.reg = SERCOM_USART_INTENCLR_RXS;
+        usart->INTFLAG.reg = SERCOM_USART_INTFLAG_RXS;
+        sb->armed = false;
+        sb->pending = true;
+        if (sb->asleep)
+            sb->stats.wakes++;
+        else
+            sb->awakeStats.wakes++;
+    }
+    // Check the first byte before Uart::IrqHandler() reads it and clears
+    // STATUS, its value is checked by waitFirstBytes() once it is in the ring
+    if (sb->pending && (usart->INTFLAG.reg & (SERCOM_USART_INTFLAG_RXC | SERCOM_USART_INTFLAG_ERROR))) {
+        sb->firstIntact = (usart->INTFLAG.bit.RXC) &&
+            !(usart->STATUS.reg & (SERCOM_USART_STATUS_FERR | SERCOM_USART_STATUS_PERR | SERCOM_USART_STATUS_BUFOVF));
+        sb->firstElapsed = micros() - sb->rxsMicros;
+        sb->firstQueued = sb->port->uart->available();
+        sb->pending = false;
+        sb->received = true;
+    }
+    return false;
+}
+
+void SerialStandby::arm(bool asleep) {
+    for (uint8_t i = 0; i < portCount; i++) {
+        SerialStandby *sb = ports[i];
+        SercomUsart *usart = &sb->port->sercom->USART;
+        sb->asleep = asleep;
+        sb->pending = false;
+        sb->received = false;
+        usart->INTFLAG.reg = SERCOM_USART_INTFLAG_RXS;
+        sb->armed = true;
+        usart->INTENSET.reg = SERCOM_USART_INTENSET_RXS;
+    }
+}
+
+// Waits for the first byte of every port that saw a start bit and records it
+void SerialStandby::waitFirstBytes() {
+    for (uint8_t i = 0; i < portCount; i++) {
+        SerialStandby *sb = ports[i];
+        StandbyStats *target = sb->asleep ? &sb->stats : &sb->awakeStats;
+        if (sb->pending) {
+            while (sb->pending && (micros() - sb->rxsMicros < 2*sb->frameMicros)) ;
+            uint32_t primask = __get_PRIMASK();
+            __disable_irq();
+            if (sb->pending) {
+                sb->pending = false;
+                target->lost++;
+            }
+            __set_PRIMASK(primask);
+        }
+        if (sb->received) {
+            sb->received = false;
+            // A byte mis-sampled after a late wake can still have a valid stop bit
+            bool intact = sb->firstIntact;
+            if (intact && (sb->expectedFirstByte >= 0))
+                intact = (sb->firstQueued == 0) && (sb->port->uart->peek() == sb->expectedFirstByte);
+            sb->record(target, intact, sb->firstElapsed);
+        }
+    }
+}
+
+void SerialStandby::sleep() {
+    if (!portCount)
+        return;
+    __disable_irq();
+    arm(true);
+    // Do not sleep if a byte is already waiting; a pending interrupt ends
+    // WFI even with interrupts masked, the handlers run once they are unmasked
+    bool busy = false;
+    for (uint8_t i = 0; i < portCount; i++)
+        busy |= (ports[i]->port->uart->available() > 0);
+    if (!busy) {
+        // A SysTick interrupt would end the sleep within a millisecond
+        uint32_t tickint = SysTick->CTRL & SysTick_CTRL_TICKINT_Msk;
+        SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
+        SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+        __DSB();
+        __WFI();
+        SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+        SysTick->CTRL |= tickint;
+    }
+    __enable_irq();
+    waitFirstBytes();
+
+    for (uint8_t i = 0; i < portCount; i++) {
+        ports[i]->armed = false;
+        ports[i]->port->sercom->USART.INTENCLR.reg = SERCOM_USART_INTENCLR_RXS;
+    }
+}
+
+bool SerialStandby::measureAwake(uint32_t timeout) {
+    if (!portCount)
+        return false;
+    arm(false);
+    uint32_t start = millis();
+    bool woken = false;
+    while (!woken && (millis() - start < timeout)) {
+        for (uint8_t i = 0; i < portCount; i++)
+            woken |= ports[i]->pending || !ports[i]->armed;
+    }
+    for (uint8_t i = 0; i < portCount; i++) {
+        ports[i]->armed = false;
+        ports[i]->port->sercom->USART.INTENCLR.reg = SERCOM_USART_INTENCLR_RXS;
+    }
+    waitFirstBytes();
+    return woken;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <Arduino.h>
+#include "ExtraSerial.h"
+
+#define STANDBY_MAX_PORTS (3)
+
+typedef struct {
+  uint32_t wakes;                          // start bits detected while armed
+  uint32_t firstBytes;                     // first bytes received intact, latency measured
+  uint32_t saturated;                      // first bytes received intact, latency >= frame time
+  uint32_t lost;                           // first bytes with an error or never completed
+  uint32_t lastLatency;                    // µs from start bit to the RXS interrupt
+  uint32_t maxLatency;
+  uint64_t totalLatency;                   // totalLatency/firstBytes = average latency
+} StandbyStats;
+
+/*
+ * Standby sleep with start-of-frame wakeup on the extra serial ports.
+ *
+ * begin() sets RUNSTDBY and the start-of-frame detection (SFDE) on the
+ * SERCOM of a port. sleep() arms the RXS interrupt of every port and puts
+ * the core in standby. The start bit of the first incoming byte wakes the
+ * core and that byte is received by Uart::IrqHandler() as usual.
+ *
+ * The RXS interrupt runs at (start bit + wake latency) and the RXC
+ * interrupt of the same byte at (start bit + frame time), so
+ *   wake latency = frame time - (RXC time - RXS time)
+ * measured with micros() once the core runs. measureAwake() does the same
+ * without sleeping to give the baseline interrupt latency. A first byte
+ * that completes with a frame, parity or overflow error, or that does not
+ * complete within two frame times, is counted as lost. A byte mis-sampled
+ * after a slow wake can still end with a valid stop bit: set
+ * expectedFirstByte, and have the sender start every burst with it, to
+ * count a first byte with another value as lost too. The check reads the
+ * oldest byte of the Uart RX ring, read the port empty before sleeping.
+ *
+ * The measurement only covers latencies shorter than one frame time (about
+ * 87 µs at 115200 baud). When the wake takes longer, RXC is already set
+ * when the RXS interrupt runs and the latency cannot be known: such first
+ * bytes are counted as saturated and left out of the latency figures.
+ *
+ * The first begin() keeps GCLK0 and the DFLL48M running in standby and
+ * applies the NVM SLEEPPRM errata workaround, without which the SERCOM
+ * would have no clock and the core might not wake.
+ *
+ * The SysTick interrupt is disabled during sleep(), so millis() does not
+ * advance while asleep. The USB device is suspended too, use an extra port
+ * to report the results.
+ */
+class SerialStandby {
+  public:
+    // Returns false if the port is already hooked by another add-on library
+    // or if STANDBY_MAX_PORTS ports are already set up
+    bool begin(ExtraSerialPort *port, unsigned long baud);
+    void end();
+
+    StandbyStats stats;                    // while sleeping
+    StandbyStats awakeStats;               // measureAwake() baseline
+    int expectedFirstByte = -1;            // value of an intact first byte, -1: any
+
+    // With onDemand, the DFLL48M is stopped in standby and restarted by the
+    // SERCOM that detects a start bit: less current but a longer wake
+    // latency and a risk of losing the first byte. Otherwise it keeps
+    // running in standby, which is the default. Applies to all ports.
+    static void setClockOnDemand(bool onDemand);
+
+    // Standby until a start bit on one of the ports or another interrupt,
+    // then waits until the first byte is received or deemed lost
+    static void sleep();
+
+    // Arms the ports without sleeping and waits up to timeout ms for a
+    // first byte. Returns false on timeout.
+    static bool measureAwake(uint32_t timeout);
+
+  private:
+    static void prepareStandby();
+    static bool hook(void *context);
+    static void arm(bool asleep);
+    static void waitFirstBytes();
+    void record(StandbyStats *target, bool intact, uint32_t elapsed);
+
+    static SerialStandby *ports[STANDBY_MAX_PORTS];
+    static uint8_t portCount;
+    static bool prepared;                  // prepareStandby() done
+
+    ExtraSerialPort *port = NULL;
+    uint32_t frameMicros;                  // start edge to RXC, stop bit sampled
+    volatile bool armed = false;           // RXS interrupt enabled
+    volatile bool pending = false;         // RXS seen, waiting for the first byte
+    volatile bool asleep = false;          // armed by sleep() rather than measureAwake()
+    volatile uint32_t rxsMicros;
+    volatile bool rxcAtRxs;                // RXC already set when the RXS interrupt ran
+    volatile bool received = false;        // first byte in, not yet recorded
+    bool firstIntact;                      // completed without error
+    uint32_t firstElapsed;                 // µs from the RXS to the RXC interrupt
+    int firstQueued;                       // bytes ahead of it in the Uart RX ring
+};
@@ -0,0 +1,152 @@
+/*
+ * standby_idle
+ *
+ * Standby sleep with start-of-frame wakeup on the extra hardware serial
+ * ports of the Seeeduino XIAO board based on the Sam D21G microcontroller
+ *
+ */
+
+// Copyright 2022, Michel Deslierres, no rights reserved.
+// In those jurisdictions where releasing a work into the public domain may be a problem,
+// the BSD Zero Clause License <https://spdx.org/licenses/0BSD.html> applies.
+// SPDX-License-Identifier: 0BSD
+
+/*
+ * Serial2, Serial3 and Serial4 run in standby with start-of-frame detection.
+ * The loop() sleeps until a byte arrives on any of them, echoes what was
+ * received and goes back to sleep.
+ *
+ * The sender must start every burst with FIRST_BYTE ('U', alternating
+ * bits): a first byte that arrives with another value was mis-sampled and
+ * is counted as lost, even if its stop bit was valid.
+ *
+ * Sending "U?" on Serial2 prints, on Serial2, the wake latency and first-byte
+ * loss statistics in standby next to the baseline measured while awake.
+ * Wakes longer than one character time (87 us at 115200 baud) are only
+ * counted as saturated, use a lower USART_BAUD to measure them.
+ * Sending "U!" toggles the DFLL48M between running in standby (the default)
+ * and on-demand operation. Send each command in one go, as a line, so that
+ * it is a single burst.
+ *
+ * The USB device does not work in standby, so Serial (= USBSerial) is only
+ * used before the first sleep.
+ *
+ * Wiring
+ *
+ *   A 3.3 V USB-serial adapter or another board sends to the RX pins:
+ *
+ *   Adapter-TX --> Serial2-RX   A9
+ *   Adapter-RX <-- Serial2-TX   A10
+ *   Serial3-RX                  A5     (optional)
+ *   Serial4-RX                  SWDIO  (optional)
+ *
+ *   For the baseline, send a few lines starting with 'U' to Serial2 within
+ *   10 seconds of the "Measuring awake latency" message.
+ *
+ * To build with PlatformIO, copy this file to ../src/ as standby_idle.cpp
+ * in place of 4usarts.cpp.
+ */
+
+#include <Arduino.h>            // Needed for PlatformIO
+#include "wiring_private.h"     // for pinPeripheral() function
+#include "Serial2.h"
+#include "Serial3.h"
+#include "Serial4.h"
+#include "SerialStandby.h"
+
+#define USART_BAUD    115200    // Baud for USARTs
+#define FIRST_BYTE    'U'       // first byte of every burst
+
+SerialStandby standby2;
+SerialStandby standby3;
+SerialStandby standby4;
+bool onDemand = false;
+
+void setup() {
+  // Wait up to 10 seconds for Serial (= USBSerial) port to come up.
+  unsigned long startserial = millis();
+  while (!Serial && (millis() - startserial < 10000)) ;
+
+  Serial.println("\n\nstandby_idle");
+  Serial.println("------------");
+
+  Serial2.begin(USART_BAUD);
+  pinPeripheral(PIN_SERIAL2_TX, PIO_SERCOM_ALT);
+  pinPeripheral(PIN_SERIAL2_RX, PIO_SERCOM_ALT);
+  Serial3.begin(USART_BAUD);
+  pinPeripheral(PIN_SERIAL3_TX, PIO_SERCOM_ALT);
+  pinPeripheral(PIN_SERIAL3_RX, PIO_SERCOM_ALT);
+  Serial4.begin(USART_BAUD);
+  pinPeripheral(PIN_SERIAL4_TX, PIO_SERCOM_ALT);
+  pinPeripheral(PIN_SERIAL4_RX, PIO_SERCOM_ALT);
+
+  standby2.begin(&Serial2Port, USART_BAUD);
+  standby3.begin(&Serial3Port, USART_BAUD);
+  standby4.begin(&Serial4Port, USART_BAUD);
+  standby2.expectedFirstByte = FIRST_BYTE;
+  standby3.expectedFirstByte = FIRST_BYTE;
+  standby4.expectedFirstByte = FIRST_BYTE;
+  SerialStandby::setClockOnDemand(onDemand);
+
+  Serial.println("Measuring awake latency, send lines starting with U to Serial2");
+  Serial2.println("Measuring awake latency, send lines starting with U");
+  for (int i = 0; i < 10; i++) {
+    if (!SerialStandby::measureAwake(10000))
+      break;
+    // Let the rest of the line arrive, the next first byte must find the ring empty
+    delay(5);
+    while (Serial2.available())
+      Serial2.read();
+  }
+
+  Serial.println("Setup completed, USB will stop when the loop sleeps");
+  Serial.flush();
+  delay(100);
+}
+
+void report(const char *name, SerialStandby &sb) {
+  StandbyStats &s = sb.stats;
+  StandbyStats &a = sb.awakeStats;
+  Serial2.printf("%s standby: %lu wakes, latency avg %lu us, max %lu us, %lu saturated, %lu/%lu first bytes lost\r\n",
+    name, s.wakes, s.firstBytes ? (uint32_t) (s.totalLatency / s.firstBytes) : 0, s.maxLatency,
+    s.saturated, s.lost, s.firstBytes + s.saturated + s.lost);
+  Serial2.printf("%s awake:   %lu bytes, latency avg %lu us, max %lu us, %lu saturated, %lu/%lu first bytes lost\r\n",
+    name, a.wakes, a.firstBytes ? (uint32_t) (a.totalLatency / a.firstBytes) : 0, a.maxLatency,
+    a.saturated, a.lost, a.firstBytes + a.saturated + a.lost);
+}
+
+// Echoes what was received on a port, returns the last character
+int echo(Uart &uart) {
+  int c = -1;
+  while (uart.available()) {
+    c = uart.read();
+    uart.write(c);
+  }
+  return c;
+}
+
+void loop() {
+  SerialStandby::sleep();
+
+  // Let the rest of a burst arrive before going back to sleep
+  delay(2);
+
+  int c = echo(Serial2);
+  echo(Serial3);
+  echo(Serial4);
+
+  if (c == '?') {
+    Serial2.printf("\r\nDFLL48M %s in standby\r\n", onDemand ? "on demand" : "running");
+    report("Serial2", standby2);
+    report("Serial3", standby3);
+    report("Serial4", standby4);
+  } else if (c == '!') {
+    onDemand = !onDemand;
+    SerialStandby::setClockOnDemand(onDemand);
+    Serial2.printf("\r\nDFLL48M %s in standby\r\n", onDemand ? "on demand" : "running");
+  }
+  // Finish transmitting before the next sleep
+  Serial2.flush();
+  Serial3.flush();
+  Serial4.flush();
+}
@@ -0,0 +1,121 @@
+// Host tests of autoBaudEstimate() against simulated 8N1 traffic
+//
+//   pio test -e native
+
+#include <unity.h>
+#include "AutoBaudEstimate.h"
+
+#define TICK_HZ     (48000000UL)           // TC clocked from GCLK0 as in AutoBaud
+#define JITTER      (3)                    // ± ticks on every edge
+#define MAX_WIDTHS  (64)                   // AUTOBAUD_MAX_WIDTHS
+
+const char message[] = "UUUU The quick brown fox\n";
+
+const uint32_t standardRates[] = { 1200, 9600, 19200, 31250, 57600, 115200, 230400, 250000, 460800, 921600 };
+const uint32_t otherRates[] = { 74880, 100000, 123456, 200000 };
+
+static uint32_t seed;
+
+// Deterministic jitter in [-JITTER, JITTER]
+static int jitter() {
+  seed = seed * 1103515245 + 12345;
+  return (int) ((seed >> 16) % (2*JITTER + 1)) - JITTER;
+}
+
+// Widths in ticks of the high and low pulses of message sent at baud with
+// one start bit, 8 data bits and one stop bit, as captured by the TC:
+// the leading and trailing idle levels are not pulses and widths that do
+// not fit in 16 bits are lost to a TC overflow.
+size_t simulate(uint32_t baud, uint16_t *widths, size_t max) {
+  uint8_t bits[10 * sizeof(message)];
+  size_t nbits = 0;
+  for (const char *c = message; *c; c++) {
+    bits[nbits++] = 0;
+    for (int i = 0; i < 8; i++)
+      bits[nbits++] = (*c >> i) & 1;
+    bits[nbits++] = 1;
+  }
+
+  // The first edge is the start bit of the first character at t = 0, the
+  // final stop bit merges with the idle line
+  seed = baud;
+  size_t count = 0;
+  int64_t lastEdge = JITTER + jitter();
+  for (size_t i = 1; (i < nbits) && (count < max); i++) {
+    if (bits[i] == bits[i - 1])
+      continue;
+    int64_t edge = JITTER + (int64_t) ((uint64_t) i * TICK_HZ / baud) + jitter();
+    if (edge - lastEdge <= 0xFFFF)
+      widths[count++] = (uint16_t) (edge - lastEdge);
+    lastEdge = edge;
+  }
+  return count;
+}
+
+void setUp(void) {
+}
+
+void tearDown(void) {
+}
+
+void test_standard_rates_snap(void) {
+  uint16_t widths[MAX_WIDTHS];
+  for (size_t i = 0; i < sizeof(standardRates)/sizeof(standardRates[0]); i++) {
+    size_t n = simulate(standardRates[i], widths, MAX_WIDTHS);
+    TEST_ASSERT_EQUAL_UINT32(standardRates[i], autoBaudEstimate(widths, n, TICK_HZ, true));
+  }
+}
+
+// Within 0.5% without snapping, well inside the UART receiver tolerance
+void test_standard_rates_measured(void) {
+  uint16_t widths[MAX_WIDTHS];
+  for (size_t i = 0; i < sizeof(standardRates)/sizeof(standardRates[0]); i++) {
+    uint32_t rate = standardRates[i];
+    size_t n = simulate(rate, widths, MAX_WIDTHS);
+    TEST_ASSERT_UINT32_WITHIN(rate / 200, rate, autoBaudEstimate(widths, n, TICK_HZ, false));
+  }
+}
+
+// Non-standard rates are kept as measured even with snap
+void test_nonstandard_rates(void) {
+  uint16_t widths[MAX_WIDTHS];
+  for (size_t i = 0; i < sizeof(otherRates)/sizeof(otherRates[0]); i++) {
+    uint32_t rate = otherRates[i];
+    size_t n = simulate(rate, widths, MAX_WIDTHS);
+    TEST_ASSERT_UINT32_WITHIN(rate / 200, rate, autoBaudEstimate(widths, n, TICK_HZ, true));
+    TEST_ASSERT_UINT32_WITHIN(rate / 200, rate, autoBaudEstimate(widths, n, TICK_HZ, false));
+  }
+}
+
+// With single bit pulses of 100 ticks the estimate is tickHz/100 exactly
+void test_snap_tolerance_is_strict(void) {
+  uint16_t widths[8] = { 100, 100, 100, 100, 100, 100, 100, 100 };
+  uint32_t edge = 76800 - 76800 * AUTOBAUD_SNAP_TOLERANCE / 1000;
+
+  TEST_ASSERT_EQUAL_UINT32(edge, autoBaudEstimate(widths, 8, edge * 100, true));
+  TEST_ASSERT_EQUAL_UINT32(76800, autoBaudEstimate(widths, 8, (edge + 1) * 100, true));
+}
+
+void test_glitch_ignored(void) {
+  uint16_t widths[MAX_WIDTHS];
+  size_t n = simulate(115200, widths, MAX_WIDTHS - 1);
+  widths[n++] = 20;                        // a 0.4 µs spike on the line
+  TEST_ASSERT_EQUAL_UINT32(115200, autoBaudEstimate(widths, n, TICK_HZ, true));
+}
+
+void test_too_few_widths(void) {
+  uint16_t widths[3] = { 416, 417, 834 };
+  TEST_ASSERT_EQUAL_UINT32(0, autoBaudEstimate(widths, 3, TICK_HZ, true));
+  TEST_ASSERT_EQUAL_UINT32(0, autoBaudEstimate(widths, 0, TICK_HZ, true));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_standard_rates_snap);
+  RUN_TEST(test_standard_rates_measured);
+  RUN_TEST(test_nonstandard_rates);
+  RUN_TEST(test_snap_tolerance_is_strict);
+  RUN_TEST(test_glitch_ignored);
+  RUN_TEST(test_too_few_widths);
+  return UNITY_END();
+}
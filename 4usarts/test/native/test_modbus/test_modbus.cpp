@@ -0,0 +1,160 @@
+// Host tests of the Modbus CRC and of the simulated slave's request processing
+//
+//   pio test -e native
+
+#include <string.h>
+#include <unity.h>
+#include "ModbusCrc.h"
+#include "ModbusSlaveTable.h"
+
+#define SLAVE (7)
+
+ModbusSlaveTable slave;
+uint8_t reply[256];
+
+void setUp(void) {
+  slave.reset(SLAVE);
+  memset(reply, 0, sizeof(reply));
+}
+
+void tearDown(void) {
+}
+
+// Appends the CRC to a request of length bytes and returns the new length
+size_t addCrc(uint8_t *frame, size_t length) {
+  uint16_t crc = modbusCrc16(frame, length);
+  frame[length++] = crc & 0xFF;
+  frame[length++] = crc >> 8;
+  return length;
+}
+
+// Checks that a reply ends with its CRC, low byte first
+void assertCrc(const uint8_t *frame, size_t length) {
+  TEST_ASSERT_GREATER_THAN(2, length);
+  uint16_t crc = modbusCrc16(frame, length - 2);
+  TEST_ASSERT_EQUAL_HEX8(crc & 0xFF, frame[length - 2]);
+  TEST_ASSERT_EQUAL_HEX8(crc >> 8, frame[length - 1]);
+}
+
+void assertException(uint8_t function, uint8_t code, size_t n) {
+  TEST_ASSERT_EQUAL(5, n);
+  TEST_ASSERT_EQUAL_HEX8(SLAVE, reply[0]);
+  TEST_ASSERT_EQUAL_HEX8(function | 0x80, reply[1]);
+  TEST_ASSERT_EQUAL_HEX8(code, reply[2]);
+  assertCrc(reply, n);
+}
+
+void test_crc_check_value(void) {
+  const uint8_t data[] = "123456789";
+  TEST_ASSERT_EQUAL_HEX16(0x4B37, modbusCrc16(data, 9));
+}
+
+void test_crc_of_known_request(void) {
+  // 01 03 00 00 00 0A is sent as ... C5 CD
+  const uint8_t request[] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x0A };
+  TEST_ASSERT_EQUAL_HEX16(0xCDC5, modbusCrc16(request, sizeof(request)));
+}
+
+void test_crc_empty(void) {
+  TEST_ASSERT_EQUAL_HEX16(0xFFFF, modbusCrc16(NULL, 0));
+}
+
+void test_read_holding_registers(void) {
+  uint8_t request[8] = { SLAVE, 0x03, 0x00, 0x02, 0x00, 0x0A };
+  size_t n = slave.process(request, addCrc(request, 6), reply);
+
+  TEST_ASSERT_EQUAL(3 + 2*10 + 2, n);
+  TEST_ASSERT_EQUAL_HEX8(SLAVE, reply[0]);
+  TEST_ASSERT_EQUAL_HEX8(0x03, reply[1]);
+  TEST_ASSERT_EQUAL(20, reply[2]);
+  for (int i = 0; i < 10; i++) {
+    TEST_ASSERT_EQUAL_HEX8(0, reply[3 + 2*i]);
+    TEST_ASSERT_EQUAL_HEX8(2 + i, reply[4 + 2*i]);
+  }
+  assertCrc(reply, n);
+}
+
+void test_read_whole_table(void) {
+  uint8_t request[8] = { SLAVE, 0x03, 0x00, 0x00, 0x00, MODBUS_SIM_REGISTERS };
+  size_t n = slave.process(request, addCrc(request, 6), reply);
+
+  TEST_ASSERT_EQUAL(3 + 2*MODBUS_SIM_REGISTERS + 2, n);
+  TEST_ASSERT_EQUAL_HEX8(MODBUS_SIM_REGISTERS - 1, reply[2 + 2*MODBUS_SIM_REGISTERS]);
+  assertCrc(reply, n);
+}
+
+void test_write_single_register(void) {
+  uint8_t request[8] = { SLAVE, 0x06, 0x00, 0x05, 0x12, 0x34 };
+  size_t length = addCrc(request, 6);
+  size_t n = slave.process(request, length, reply);
+
+  TEST_ASSERT_EQUAL(8, n);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(request, reply, 8);   // echo of the request
+  TEST_ASSERT_EQUAL_HEX16(0x1234, slave.registers[5]);
+  TEST_ASSERT_EQUAL_HEX16(4, slave.registers[4]);
+}
+
+void test_illegal_function(void) {
+  uint8_t request[8] = { SLAVE, 0x04, 0x00, 0x00, 0x00, 0x01 };
+  assertException(0x04, 0x01, slave.process(request, addCrc(request, 6), reply));
+}
+
+void test_illegal_data_address(void) {
+  uint8_t request[8] = { SLAVE, 0x03, 0x00, MODBUS_SIM_REGISTERS - 2, 0x00, 0x03 };
+  assertException(0x03, 0x02, slave.process(request, addCrc(request, 6), reply));
+
+  uint8_t none[8] = { SLAVE, 0x03, 0x00, 0x00, 0x00, 0x00 };
+  assertException(0x03, 0x02, slave.process(none, addCrc(none, 6), reply));
+
+  uint8_t tooMany[8] = { SLAVE, 0x03, 0x00, 0x00, 0x00, 126 };
+  assertException(0x03, 0x02, slave.process(tooMany, addCrc(tooMany, 6), reply));
+
+  uint8_t write[8] = { SLAVE, 0x06, 0x00, MODBUS_SIM_REGISTERS, 0x00, 0x01 };
+  assertException(0x06, 0x02, slave.process(write, addCrc(write, 6), reply));
+}
+
+void test_illegal_data_value(void) {
+  uint8_t request[8] = { SLAVE, 0x03, 0x00, 0x00, 0x00 };
+  assertException(0x03, 0x03, slave.process(request, addCrc(request, 5), reply));
+}
+
+void test_ignored_requests(void) {
+  uint8_t other[8] = { SLAVE + 1, 0x03, 0x00, 0x00, 0x00, 0x01 };
+  TEST_ASSERT_EQUAL(0, slave.process(other, addCrc(other, 6), reply));
+
+  uint8_t badCrc[8] = { SLAVE, 0x03, 0x00, 0x00, 0x00, 0x01 };
+  size_t length = addCrc(badCrc, 6);
+  badCrc[length - 1] ^= 0x01;
+  TEST_ASSERT_EQUAL(0, slave.process(badCrc, length, reply));
+
+  TEST_ASSERT_EQUAL(0, slave.process(badCrc, 3, reply));     // too short
+}
+
+// A broadcast write is carried out without a reply
+void test_broadcast_write(void) {
+  uint8_t request[8] = { 0, 0x06, 0x00, 0x03, 0xAB, 0xCD };
+  TEST_ASSERT_EQUAL(0, slave.process(request, addCrc(request, 6), reply));
+  TEST_ASSERT_EQUAL_HEX16(0xABCD, slave.registers[3]);
+
+  uint8_t outside[8] = { 0, 0x06, 0x00, MODBUS_SIM_REGISTERS, 0x00, 0x01 };
+  TEST_ASSERT_EQUAL(0, slave.process(outside, addCrc(outside, 6), reply));
+
+  uint8_t read[8] = { 0, 0x03, 0x00, 0x00, 0x00, 0x01 };
+  TEST_ASSERT_EQUAL(0, slave.process(read, addCrc(read, 6), reply));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_crc_check_value);
+  RUN_TEST(test_crc_of_known_request);
+  RUN_TEST(test_crc_empty);
+  RUN_TEST(test_read_holding_registers);
+  RUN_TEST(test_read_whole_table);
+  RUN_TEST(test_write_single_register);
+  RUN_TEST(test_illegal_function);
+  RUN_TEST(test_illegal_data_address);
+  RUN_TEST(test_illegal_data_value);
+  RUN_TEST(test_ignored_requests);
+  RUN_TEST(test_broadcast_write);
+  return UNITY_END();
+}